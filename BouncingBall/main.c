@@ -1,15 +1,1040 @@
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-#undef main
+#include "../common/frame_stats.h"
 
-int main(void)
+#define WIDTH  800
+#define HEIGHT 600
+
+#define BALL_LANES  4   // balls per SIMD step; arrays are padded to a multiple
+#define MAX_THREADS 64
+
+#define SIM_HZ         60     // simulation steps per second
+#define MAX_FRAME_TIME 0.25   // longest frame the clock will catch up on
+
+// structure of arrays, so the kernel loads 4 balls' x (or vy, ...) at once.
+// All balls share one radius and one gravity.
+typedef struct {
+    int count;
+    int capacity;   // count rounded up to BALL_LANES
+    float *x, *y;
+    float *vx, *vy;
+    float gravity;
+    int radius;
+} Balls;
+
+// positions before the last step, and the blend drawn between the two
+typedef struct {
+    float *prev_x, *prev_y;
+    float *draw_x, *draw_y;
+} BallLerp;
+
+// one contiguous range of balls [first, last), a multiple of BALL_LANES wide
+typedef struct {
+    Balls *balls;
+    int first;
+    int last;
+} BallJob;
+
+typedef struct {
+    SDL_Thread *thread;
+    SDL_sem *start;
+    SDL_sem *done;
+    BallJob job;
+    int quit;
+} BallWorker;
+
+typedef struct {
+    int threads;
+    BallWorker workers[MAX_THREADS];
+} BallPool;
+
+// The glow and core circles rasterized once into a texture, so a ball is
+// drawn as one textured quad. The quads of all balls share one vertex and
+// index buffer, sized once for the ball count.
+typedef struct {
+    SDL_Texture *texture;
+    int radius;
+    int capacity;       // balls the buffers hold
+    SDL_Vertex *verts;  // 4 per ball; only the positions change per frame
+    int *indices;       // 6 per ball, filled once
+} BallSprite;
+
+// Uniform grid for the collision broad phase, rebuilt every frame with a
+// counting sort. Cells are one diameter wide, so touching balls are always
+// in the same or a neighbouring cell. Everything is allocated once for the
+// ball count; a rebuild never allocates.
+typedef struct {
+    int cols, rows;
+    float cell;         // cell size, one diameter
+    int *cell_start;    // cols * rows + 1 offsets into sorted
+    int *cell_of;       // cell of each ball
+    int *sorted;        // ball indices grouped by cell
+    float *sx, *sy;     // ball state gathered in sorted order, so the
+    float *svx, *svy;   // narrow phase reads contiguous memory
+} BallGrid;
+
+// Fixed-timestep clock: real time goes into an accumulator, which is paid
+// out in whole simulation steps of dt. The renderer draws whatever is left
+// over as a blend between the last two states, so the simulation runs at
+// SIM_HZ whatever the display does. A slow frame is followed by several
+// steps and no extra frames: frames get dropped, steps never do.
+typedef struct {
+    double dt;              // seconds per simulation step
+    double accumulator;     // real time not simulated yet
+    double freq;
+    Uint64 last;            // start of the previous frame
+    Uint64 mark;            // start of the current frame
+    // counters for the current one-second report
+    Uint64 report_start;
+    int steps;
+    int frames;
+    int dropped;            // frames skipped because a frame ran > 1 step
+    int lost;               // steps given up after a stall (see MAX_FRAME_TIME)
+    double sim_ms;
+    double frame_ms;
+    double frame_ms_max;
+} FixedClock;
+
+void fixed_clock_init(FixedClock *clock, int hz) {
+    memset(clock, 0, sizeof(*clock));
+    clock->dt = 1.0 / hz;
+    clock->freq = (double)SDL_GetPerformanceFrequency();
+    clock->last = clock->report_start = SDL_GetPerformanceCounter();
+}
+
+// Starts a frame and returns how many simulation steps it has to run.
+// Only a stall longer than MAX_FRAME_TIME (a debugger, a dragged window)
+// gives up time, and the steps it gives up are counted.
+int fixed_clock_begin(FixedClock *clock) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    double elapsed = (now - clock->last) / clock->freq;
+    clock->last = clock->mark = now;
+
+    if (elapsed > MAX_FRAME_TIME) {
+        clock->lost += (int)((elapsed - MAX_FRAME_TIME) / clock->dt);
+        elapsed = MAX_FRAME_TIME;
+    }
+
+    clock->accumulator += elapsed;
+    int steps = (int)(clock->accumulator / clock->dt);
+    clock->accumulator -= steps * clock->dt;
+
+    clock->steps += steps;
+    if (steps > 1)
+        clock->dropped += steps - 1;
+    return steps;
+}
+
+// how far the next, not yet simulated, step is: 0 draws the previous state
+double fixed_clock_alpha(const FixedClock *clock) {
+    return clock->accumulator / clock->dt;
+}
+
+// charge the time since the frame started to the simulation
+void fixed_clock_sim_done(FixedClock *clock) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    clock->sim_ms += (now - clock->mark) * 1000.0 / clock->freq;
+    clock->mark = now;
+}
+
+// ends a frame; prints and resets the counters once a second
+void fixed_clock_end(FixedClock *clock) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    double ms = (now - clock->last) * 1000.0 / clock->freq;
+
+    clock->frames++;
+    clock->frame_ms += ms;
+    if (ms > clock->frame_ms_max)
+        clock->frame_ms_max = ms;
+
+    double window = (now - clock->report_start) / clock->freq;
+    if (window < 1.0)
+        return;
+
+    printf("sim %5.1f steps/s %6.3f ms/step | %5.1f fps %6.2f ms avg %6.2f max"
+           " | dropped %d lost %d\n",
+           clock->steps / window,
+           clock->steps ? clock->sim_ms / clock->steps : 0.0,
+           clock->frames / window, clock->frame_ms / clock->frames,
+           clock->frame_ms_max, clock->dropped, clock->lost);
+
+    clock->report_start = now;
+    clock->steps = clock->frames = clock->dropped = clock->lost = 0;
+    clock->sim_ms = clock->frame_ms = clock->frame_ms_max = 0.0;
+}
+
+// small deterministic generator for the starting positions
+Uint32 next_random(Uint32 *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+float random_range(Uint32 *state, float lo, float hi) {
+    return lo + (hi - lo) * (next_random(state) >> 8) / 16777216.0f;
+}
+
+// Ball 0 starts exactly where the single ball always did; the others get
+// scattered over the upper half of the screen. Padding balls copy ball 0.
+int balls_init(Balls *balls, int count, int radius) {
+    int capacity = (count + BALL_LANES - 1) / BALL_LANES * BALL_LANES;
+
+    balls->count = count;
+    balls->capacity = capacity;
+    balls->gravity = 0.75f;
+    balls->radius = radius;
+    balls->x = malloc(sizeof(float) * capacity);
+    balls->y = malloc(sizeof(float) * capacity);
+    balls->vx = malloc(sizeof(float) * capacity);
+    balls->vy = malloc(sizeof(float) * capacity);
+
+    if (!balls->x || !balls->y || !balls->vx || !balls->vy)
+        return 0;
+
+    Uint32 state = 0x12345678;
+    for (int i = 0; i < capacity; i++) {
+        if (i == 0 || i >= count) {
+            balls->x[i] = 200.0f;
+            balls->y[i] = 120.0f;
+            balls->vx[i] = 16.0f;
+            balls->vy[i] = -14.0f;
+        } else {
+            balls->x[i] = random_range(&state, radius, WIDTH - radius);
+            balls->y[i] = random_range(&state, radius, HEIGHT / 2);
+            balls->vx[i] = random_range(&state, -16.0f, 16.0f);
+            balls->vy[i] = random_range(&state, -14.0f, 0.0f);
+        }
+    }
+    return 1;
+}
+
+void balls_free(Balls *balls) {
+    free(balls->x);
+    free(balls->y);
+    free(balls->vx);
+    free(balls->vy);
+}
+
+int lerp_init(BallLerp *lerp, const Balls *balls) {
+    size_t bytes = sizeof(float) * balls->count;
+    lerp->prev_x = malloc(bytes);
+    lerp->prev_y = malloc(bytes);
+    lerp->draw_x = malloc(bytes);
+    lerp->draw_y = malloc(bytes);
+    if (!lerp->prev_x || !lerp->prev_y || !lerp->draw_x || !lerp->draw_y)
+        return 0;
+
+    memcpy(lerp->prev_x, balls->x, bytes);
+    memcpy(lerp->prev_y, balls->y, bytes);
+    return 1;
+}
+
+void lerp_free(BallLerp *lerp) {
+    free(lerp->prev_x);
+    free(lerp->prev_y);
+    free(lerp->draw_x);
+    free(lerp->draw_y);
+}
+
+// call before every simulation step
+void lerp_save(BallLerp *lerp, const Balls *balls) {
+    memcpy(lerp->prev_x, balls->x, sizeof(float) * balls->count);
+    memcpy(lerp->prev_y, balls->y, sizeof(float) * balls->count);
+}
+
+// Returns a view of the balls at alpha between the previous and the
+// current step, for drawing only; the simulation state is not touched.
+Balls lerp_blend(BallLerp *lerp, const Balls *balls, float alpha) {
+    Balls view = *balls;
+
+    for (int i = 0; i < balls->count; i++) {
+        lerp->draw_x[i] = lerp->prev_x[i] + (balls->x[i] - lerp->prev_x[i]) * alpha;
+        lerp->draw_y[i] = lerp->prev_y[i] + (balls->y[i] - lerp->prev_y[i]) * alpha;
+    }
+    view.x = lerp->draw_x;
+    view.y = lerp->draw_y;
+    return view;
+}
+
+// Euler step, floor bounce with 0.96 restitution and wall reflection for
+// balls [first, last). x is clamped back inside and vx is pointed away from
+// the wall it touched, so a ball can never get stuck flipping outside it;
+// for the original single ball this is exactly the old behaviour.
+void integrate_range(Balls *balls, int first, int last) {
+    float r = (float)balls->radius;
+    float g = balls->gravity;
+    int i = first;
+
+#ifdef __SSE2__
+    __m128 gravity = _mm_set1_ps(g);
+    __m128 restitution = _mm_set1_ps(-0.96f);
+    __m128 floor_y = _mm_set1_ps(HEIGHT - r);
+    __m128 left_x = _mm_set1_ps(r);
+    __m128 right_x = _mm_set1_ps(WIDTH - r);
+    __m128 sign_bit = _mm_set1_ps(-0.0f);
+
+    for (; i + BALL_LANES <= last; i += BALL_LANES) {
+        __m128 vx = _mm_loadu_ps(balls->vx + i);
+        __m128 vy = _mm_loadu_ps(balls->vy + i);
+        __m128 x = _mm_add_ps(_mm_loadu_ps(balls->x + i), vx);
+        __m128 y = _mm_add_ps(_mm_loadu_ps(balls->y + i), vy);
+        vy = _mm_add_ps(vy, gravity);
+
+        __m128 on_floor = _mm_cmpge_ps(y, floor_y);
+        y = _mm_or_ps(_mm_and_ps(on_floor, floor_y), _mm_andnot_ps(on_floor, y));
+        vy = _mm_or_ps(_mm_and_ps(on_floor, _mm_mul_ps(vy, restitution)),
+                       _mm_andnot_ps(on_floor, vy));
+
+        // |vx| away from the left wall, -|vx| away from the right one
+        __m128 speed = _mm_andnot_ps(sign_bit, vx);
+        __m128 at_left = _mm_cmple_ps(x, left_x);
+        __m128 at_right = _mm_cmpge_ps(x, right_x);
+        vx = _mm_or_ps(_mm_and_ps(at_left, speed), _mm_andnot_ps(at_left, vx));
+        vx = _mm_or_ps(_mm_and_ps(at_right, _mm_or_ps(speed, sign_bit)),
+                       _mm_andnot_ps(at_right, vx));
+        x = _mm_min_ps(_mm_max_ps(x, left_x), right_x);
+
+        _mm_storeu_ps(balls->x + i, x);
+        _mm_storeu_ps(balls->y + i, y);
+        _mm_storeu_ps(balls->vx + i, vx);
+        _mm_storeu_ps(balls->vy + i, vy);
+    }
+#endif
+
+    for (; i < last; i++) {
+        float vx = balls->vx[i];
+        float vy = balls->vy[i];
+        float x = balls->x[i] + vx;
+        float y = balls->y[i] + vy;
+        vy += g;
+
+        if (y >= HEIGHT - r) {
+            y = HEIGHT - r;
+            vy = vy * -0.96f;
+        }
+
+        if (x <= r) {
+            x = r;
+            vx = fabsf(vx);
+        } else if (x >= WIDTH - r) {
+            x = WIDTH - r;
+            vx = -fabsf(vx);
+        }
+
+        balls->x[i] = x;
+        balls->y[i] = y;
+        balls->vx[i] = vx;
+        balls->vy[i] = vy;
+    }
+}
+
+static int ball_worker_main(void *data) {
+    BallWorker *worker = data;
+
+    for (;;) {
+        SDL_SemWait(worker->start);
+        if (worker->quit)
+            break;
+        integrate_range(worker->job.balls, worker->job.first, worker->job.last);
+        SDL_SemPost(worker->done);
+    }
+    return 0;
+}
+
+// the calling thread always runs one range itself, so a pool of
+// N threads only spawns N - 1 workers
+void ball_pool_init(BallPool *pool, int threads) {
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    pool->threads = threads;
+    for (int i = 0; i < threads - 1; i++) {
+        BallWorker *worker = &pool->workers[i];
+        worker->quit = 0;
+        worker->start = SDL_CreateSemaphore(0);
+        worker->done = SDL_CreateSemaphore(0);
+        worker->thread = SDL_CreateThread(ball_worker_main, "balls", worker);
+    }
+}
+
+void ball_pool_destroy(BallPool *pool) {
+    for (int i = 0; i < pool->threads - 1; i++) {
+        BallWorker *worker = &pool->workers[i];
+        worker->quit = 1;
+        SDL_SemPost(worker->start);
+        SDL_WaitThread(worker->thread, NULL);
+        SDL_DestroySemaphore(worker->start);
+        SDL_DestroySemaphore(worker->done);
+    }
+    pool->threads = 1;
+}
+
+// Balls are independent, so each thread integrates its own slice. Small
+// systems stay on the calling thread, where a wakeup would cost more than
+// the work.
+void update_balls(Balls *balls, BallPool *pool) {
+    int lanes = balls->capacity / BALL_LANES;
+    int parts = pool->threads;
+    if (parts > lanes / 1024)
+        parts = lanes / 1024 > 1 ? lanes / 1024 : 1;
+
+    BallJob job;
+    job.balls = balls;
+
+    for (int i = 0; i < parts; i++) {
+        job.first = (int)((Sint64)lanes * i / parts) * BALL_LANES;
+        job.last = (int)((Sint64)lanes * (i + 1) / parts) * BALL_LANES;
+
+        if (i == parts - 1) {
+            integrate_range(balls, job.first, job.last);
+        } else {
+            pool->workers[i].job = job;
+            SDL_SemPost(pool->workers[i].start);
+        }
+    }
+    for (int i = 0; i < parts - 1; i++)
+        SDL_SemWait(pool->workers[i].done);
+}
+
+// The original per-pixel drawing, one SDL_RenderDrawPoint per covered pixel.
+// Only kept so --draw-bench can show what the sprite saves.
+void draw_ball_points(SDL_Renderer *renderer, float x, float y, int radius) {
+    SDL_SetRenderDrawColor(renderer, 255, 140, 0, 80);
+    for (int dy = -radius; dy <= radius; dy++) {
+        for (int dx = -radius; dx <= radius; dx++) {
+            if (dx*dx + dy*dy <= radius*radius) {
+                SDL_RenderDrawPoint(
+                    renderer,
+                    (int)(x + dx),
+                    (int)(y + dy)
+                );
+            }
+        }
+    }
+
+
+    int core = radius - 6;
+    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+    for (int dy = -core; dy <= core; dy++) {
+        for (int dx = -core; dx <= core; dx++) {
+            if (dx*dx + dy*dy <= core*core) {
+                SDL_RenderDrawPoint(
+                    renderer,
+                    (int)(x + dx),
+                    (int)(y + dy)
+                );
+            }
+        }
+    }
+}
+
+// The sprite holds both circles: core pixels are opaque red, glow-only
+// pixels are the 80-alpha orange and the rest is transparent. Blending it
+// gives the same result as the two point passes, because the opaque core
+// fully covers the glow underneath it.
+int sprite_init(BallSprite *sprite, SDL_Renderer *renderer, int radius, int capacity) {
+    int size = 2 * radius + 1;
+    int core = radius - 6;
+
+    memset(sprite, 0, sizeof(*sprite));
+    sprite->radius = radius;
+    sprite->capacity = capacity;
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+        0, size, size, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!surface)
+        return 0;
+
+    for (int dy = -radius; dy <= radius; dy++) {
+        Uint32 *row = (Uint32 *)((Uint8 *)surface->pixels +
+                                 (dy + radius) * surface->pitch);
+        for (int dx = -radius; dx <= radius; dx++) {
+            int d2 = dx*dx + dy*dy;
+            Uint32 color = 0;
+            if (d2 <= core*core)
+                color = 0xFFFF0000u;
+            else if (d2 <= radius*radius)
+                color = (80u << 24) | (255u << 16) | (140u << 8);
+            row[dx + radius] = color;
+        }
+    }
+
+    sprite->texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (!sprite->texture)
+        return 0;
+    SDL_SetTextureBlendMode(sprite->texture, SDL_BLENDMODE_BLEND);
+
+    sprite->verts = malloc(sizeof(SDL_Vertex) * 4 * capacity);
+    sprite->indices = malloc(sizeof(int) * 6 * capacity);
+    if (!sprite->verts || !sprite->indices)
+        return 0;
+
+    static const float corner[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+    SDL_Color white = { 255, 255, 255, 255 };
+
+    for (int i = 0; i < capacity; i++) {
+        for (int k = 0; k < 4; k++) {
+            SDL_Vertex *v = &sprite->verts[4 * i + k];
+            v->color = white;
+            v->tex_coord.x = corner[k][0];
+            v->tex_coord.y = corner[k][1];
+        }
+        int *idx = &sprite->indices[6 * i];
+        idx[0] = 4 * i;     idx[1] = 4 * i + 1; idx[2] = 4 * i + 2;
+        idx[3] = 4 * i;     idx[4] = 4 * i + 2; idx[5] = 4 * i + 3;
+    }
+    return 1;
+}
+
+void sprite_free(BallSprite *sprite) {
+    if (sprite->texture)
+        SDL_DestroyTexture(sprite->texture);
+    free(sprite->verts);
+    free(sprite->indices);
+}
+
+// Top-left pixel of a ball's sprite. The point loops truncated x + dx,
+// which also folded the row and column just above/left of zero onto 0;
+// flooring places every pixel where it belongs.
+static SDL_Rect sprite_rect(const BallSprite *sprite, float x, float y) {
+    SDL_Rect dst;
+    dst.x = (int)floorf(x) - sprite->radius;
+    dst.y = (int)floorf(y) - sprite->radius;
+    dst.w = dst.h = 2 * sprite->radius + 1;
+    return dst;
+}
+
+void fade_trail(SDL_Renderer *renderer) {
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 14);
+    SDL_RenderFillRect(renderer, NULL);
+}
+
+void draw_balls_points(SDL_Renderer *renderer, const Balls *balls) {
+    for (int i = 0; i < balls->count; i++)
+        draw_ball_points(renderer, balls->x[i], balls->y[i], balls->radius);
+}
+
+// one SDL_RenderCopy per ball
+void draw_balls_copy(SDL_Renderer *renderer, const Balls *balls,
+                     const BallSprite *sprite) {
+    for (int i = 0; i < balls->count; i++) {
+        SDL_Rect dst = sprite_rect(sprite, balls->x[i], balls->y[i]);
+        SDL_RenderCopy(renderer, sprite->texture, NULL, &dst);
+    }
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+// every ball in one SDL_RenderGeometry call
+void draw_balls_batched(SDL_Renderer *renderer, const Balls *balls,
+                        BallSprite *sprite) {
+    int n = balls->count < sprite->capacity ? balls->count : sprite->capacity;
+
+    for (int i = 0; i < n; i++) {
+        SDL_Rect dst = sprite_rect(sprite, balls->x[i], balls->y[i]);
+        float x0 = (float)dst.x, x1 = (float)(dst.x + dst.w);
+        float y0 = (float)dst.y, y1 = (float)(dst.y + dst.h);
+        SDL_Vertex *v = &sprite->verts[4 * i];
+
+        v[0].position.x = x0; v[0].position.y = y0;
+        v[1].position.x = x1; v[1].position.y = y0;
+        v[2].position.x = x1; v[2].position.y = y1;
+        v[3].position.x = x0; v[3].position.y = y1;
+    }
+    SDL_RenderGeometry(renderer, sprite->texture, sprite->verts, 4 * n,
+                       sprite->indices, 6 * n);
+}
+#endif
+
+// The trail fade, then the balls: batched where the SDL version has
+// SDL_RenderGeometry, one copy per ball otherwise.
+void draw_balls(SDL_Renderer *renderer, const Balls *balls, BallSprite *sprite) {
+    fade_trail(renderer);
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (balls->count > 1) {
+        draw_balls_batched(renderer, balls, sprite);
+        return;
+    }
+#endif
+    draw_balls_copy(renderer, balls, sprite);
+}
+
+int grid_init(BallGrid *grid, const Balls *balls) {
+    grid->cell = 2.0f * balls->radius;
+    grid->cols = (int)ceilf(WIDTH / grid->cell);
+    grid->rows = (int)ceilf(HEIGHT / grid->cell);
+
+    int n = balls->count;
+    grid->cell_start = malloc(sizeof(int) * (grid->cols * grid->rows + 1));
+    grid->cell_of = malloc(sizeof(int) * n);
+    grid->sorted = malloc(sizeof(int) * n);
+    grid->sx = malloc(sizeof(float) * n);
+    grid->sy = malloc(sizeof(float) * n);
+    grid->svx = malloc(sizeof(float) * n);
+    grid->svy = malloc(sizeof(float) * n);
+
+    return grid->cell_start && grid->cell_of && grid->sorted &&
+           grid->sx && grid->sy && grid->svx && grid->svy;
+}
+
+void grid_free(BallGrid *grid) {
+    free(grid->cell_start);
+    free(grid->cell_of);
+    free(grid->sorted);
+    free(grid->sx);
+    free(grid->sy);
+    free(grid->svx);
+    free(grid->svy);
+}
+
+// Counting sort of the balls by cell: count, prefix sum, scatter. Balls that
+// flew above the screen are clamped into the top row, which keeps every
+// touching pair in neighbouring cells.
+void grid_build(BallGrid *grid, const Balls *balls) {
+    int cells = grid->cols * grid->rows;
+    int n = balls->count;
+    float inv = 1.0f / grid->cell;
+
+    memset(grid->cell_start, 0, sizeof(int) * (cells + 1));
+
+    for (int i = 0; i < n; i++) {
+        int cx = (int)(balls->x[i] * inv);
+        int cy = (int)(balls->y[i] * inv);
+        cx = cx < 0 ? 0 : (cx >= grid->cols ? grid->cols - 1 : cx);
+        cy = cy < 0 ? 0 : (cy >= grid->rows ? grid->rows - 1 : cy);
+
+        int c = cy * grid->cols + cx;
+        grid->cell_of[i] = c;
+        grid->cell_start[c + 1]++;
+    }
+
+    for (int c = 0; c < cells; c++)
+        grid->cell_start[c + 1] += grid->cell_start[c];
+
+    // cell_start[c] is used as the write cursor of cell c, which leaves it
+    // pointing at the start of cell c + 1; shift back afterwards
+    for (int i = 0; i < n; i++) {
+        int k = grid->cell_start[grid->cell_of[i]]++;
+        grid->sorted[k] = i;
+        grid->sx[k] = balls->x[i];
+        grid->sy[k] = balls->y[i];
+        grid->svx[k] = balls->vx[i];
+        grid->svy[k] = balls->vy[i];
+    }
+    for (int c = cells; c > 0; c--)
+        grid->cell_start[c] = grid->cell_start[c - 1];
+    grid->cell_start[0] = 0;
+}
+
+// Equal-mass elastic collision between a and b: push them apart along the
+// normal by half the overlap each and, if they are approaching, swap their
+// normal velocity components. Returns 1 if they touched.
+static int resolve_pair(float *x, float *y, float *vx, float *vy,
+                        int a, int b, float diameter) {
+    float dx = x[b] - x[a];
+    float dy = y[b] - y[a];
+    float d2 = dx * dx + dy * dy;
+
+    if (d2 >= diameter * diameter || d2 == 0.0f)
+        return 0;
+
+    float d = sqrtf(d2);
+    float nx = dx / d;
+    float ny = dy / d;
+    float push = 0.5f * (diameter - d);
+
+    x[a] -= nx * push; y[a] -= ny * push;
+    x[b] += nx * push; y[b] += ny * push;
+
+    float approach = (vx[b] - vx[a]) * nx + (vy[b] - vy[a]) * ny;
+    if (approach < 0.0f) {
+        vx[a] += approach * nx; vy[a] += approach * ny;
+        vx[b] -= approach * nx; vy[b] -= approach * ny;
+    }
+    return 1;
+}
+
+// The pushes in resolve_pair can shove a ball through a wall or the floor;
+// put it back where integrate_range would, so it is never drawn outside.
+static void keep_in_box(float *x, float *y, float r) {
+    if (*x < r) *x = r;
+    if (*x > WIDTH - r) *x = WIDTH - r;
+    if (*y > HEIGHT - r) *y = HEIGHT - r;
+}
+
+// Narrow phase over the grid. Each cell is tested against itself and four
+// of its neighbours (right, and the three below), so every adjacent pair is
+// visited exactly once. Returns the number of contacts.
+int collide_balls(Balls *balls, BallGrid *grid) {
+    static const int offset[4][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+    float diameter = 2.0f * balls->radius;
+    int contacts = 0;
+
+    grid_build(grid, balls);
+
+    for (int cy = 0; cy < grid->rows; cy++) {
+        for (int cx = 0; cx < grid->cols; cx++) {
+            int c = cy * grid->cols + cx;
+            int a0 = grid->cell_start[c];
+            int a1 = grid->cell_start[c + 1];
+
+            for (int a = a0; a < a1; a++)
+                for (int b = a + 1; b < a1; b++)
+                    contacts += resolve_pair(grid->sx, grid->sy, grid->svx,
+                                             grid->svy, a, b, diameter);
+
+            for (int k = 0; k < 4; k++) {
+                int nx = cx + offset[k][0];
+                int ny = cy + offset[k][1];
+                if (nx < 0 || nx >= grid->cols || ny >= grid->rows)
+                    continue;
+
+                int nc = ny * grid->cols + nx;
+                int b0 = grid->cell_start[nc];
+                int b1 = grid->cell_start[nc + 1];
+
+                for (int a = a0; a < a1; a++)
+                    for (int b = b0; b < b1; b++)
+                        contacts += resolve_pair(grid->sx, grid->sy, grid->svx,
+                                                 grid->svy, a, b, diameter);
+            }
+        }
+    }
+
+    for (int k = 0; k < balls->count; k++) {
+        int i = grid->sorted[k];
+        keep_in_box(&grid->sx[k], &grid->sy[k], (float)balls->radius);
+        balls->x[i] = grid->sx[k];
+        balls->y[i] = grid->sy[k];
+        balls->vx[i] = grid->svx[k];
+        balls->vy[i] = grid->svy[k];
+    }
+    return contacts;
+}
+
+// the O(n^2) reference the grid is measured against
+int collide_brute(Balls *balls) {
+    float diameter = 2.0f * balls->radius;
+    int contacts = 0;
+
+    for (int a = 0; a < balls->count; a++)
+        for (int b = a + 1; b < balls->count; b++)
+            contacts += resolve_pair(balls->x, balls->y, balls->vx, balls->vy,
+                                     a, b, diameter);
+
+    for (int i = 0; i < balls->count; i++)
+        keep_in_box(&balls->x[i], &balls->y[i], (float)balls->radius);
+    return contacts;
+}
+
+// Collision step time for the grid and brute force at 10K, 100K and 1M
+// balls of radius 1. Brute force at 1M would take minutes per step, so it
+// is extrapolated from the 100K time (the cost grows with n^2).
+int run_collide_benchmark(void) {
+    static const int counts[] = { 10000, 100000, 1000000 };
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double brute_ms = 0.0;
+
+    printf("%10s %12s %10s %14s %10s %10s\n", "balls", "grid ms",
+           "contacts", "brute ms", "contacts", "speedup");
+
+    for (int c = 0; c < 3; c++) {
+        int n = counts[c];
+        Balls balls;
+        BallGrid grid;
+
+        if (!balls_init(&balls, n, 1) || !grid_init(&grid, &balls)) {
+            printf("Out of memory for %d balls\n", n);
+            return 1;
+        }
+
+        int steps = 0, contacts = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        double elapsed = 0.0;
+
+        while (steps < 3 || elapsed < 0.5) {
+            int found = collide_balls(&balls, &grid);
+            if (steps == 0)
+                contacts = found;   // first step, comparable with brute force
+            steps++;
+            elapsed = (SDL_GetPerformanceCounter() - start) / freq;
+        }
+        double grid_ms = elapsed * 1000.0 / steps;
+
+        if (n <= 100000) {
+            // fresh copy of the same start state
+            balls_free(&balls);
+            balls_init(&balls, n, 1);
+
+            start = SDL_GetPerformanceCounter();
+            int brute_contacts = collide_brute(&balls);
+            brute_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / freq;
+
+            printf("%10d %12.3f %10d %14.1f %10d %9.0fx\n", n, grid_ms,
+                   contacts, brute_ms, brute_contacts, brute_ms / grid_ms);
+        } else {
+            double scale = (double)n / counts[c - 1];
+            brute_ms *= scale * scale;
+            printf("%10d %12.3f %10d %14.1f %10s %9.0fx\n", n, grid_ms,
+                   contacts, brute_ms, "(est.)", brute_ms / grid_ms);
+        }
+
+        grid_free(&grid);
+        balls_free(&balls);
+    }
+    return 0;
+}
+
+// Offscreen draw cost per ball for the old point loops, one sprite copy per
+// ball and (where available) one batched SDL_RenderGeometry call. The
+// full-screen fade is the same for every path, so it is timed on its own.
+int run_draw_benchmark(int radius) {
+    static const int counts[] = { 1, 10, 100, 1000 };
+    const char *names[3] = { "points", "copy", "batched" };
+    double freq = (double)SDL_GetPerformanceFrequency();
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    if (!renderer) {
+        printf("Offscreen renderer failed: %s\n", SDL_GetError());
+        return 1;
+    }
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    // fade alone, to subtract from every row
+    int frames = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    double elapsed = 0.0;
+    while (frames < 3 || elapsed < 0.25) {
+        fade_trail(renderer);
+        frames++;
+        elapsed = (SDL_GetPerformanceCounter() - start) / freq;
+    }
+    double fade_ms = elapsed * 1000.0 / frames;
+
+    printf("radius %d, fade %.3f ms/frame\n", radius, fade_ms);
+    printf("%8s %10s %12s %14s\n", "balls", "path", "balls ms", "us per ball");
+
+    for (int c = 0; c < 4; c++) {
+        Balls balls;
+        BallSprite sprite;
+
+        if (!balls_init(&balls, counts[c], radius) ||
+            !sprite_init(&sprite, renderer, radius, counts[c])) {
+            printf("Setup failed for %d balls\n", counts[c]);
+            return 1;
+        }
+
+        for (int path = 0; path < 3; path++) {
+#if !SDL_VERSION_ATLEAST(2, 0, 18)
+            if (path == 2)
+                continue;
+#endif
+            frames = 0;
+            start = SDL_GetPerformanceCounter();
+            elapsed = 0.0;
+
+            while (frames < 3 || elapsed < 0.25) {
+                if (path == 0)
+                    draw_balls_points(renderer, &balls);
+                else if (path == 1)
+                    draw_balls_copy(renderer, &balls, &sprite);
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+                else
+                    draw_balls_batched(renderer, &balls, &sprite);
+#endif
+                frames++;
+                elapsed = (SDL_GetPerformanceCounter() - start) / freq;
+            }
+
+            double ms = elapsed * 1000.0 / frames;
+            printf("%8d %10s %12.3f %14.2f\n", counts[c], names[path], ms,
+                   ms * 1000.0 / counts[c]);
+        }
+
+        sprite_free(&sprite);
+        balls_free(&balls);
+    }
+
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    return 0;
+}
+
+// Update-only throughput from 1K balls up to max_balls, on one thread and
+// on the whole pool. Nothing is drawn.
+int run_benchmark(int max_balls, int threads) {
+    double freq = (double)SDL_GetPerformanceFrequency();
+    BallPool single, pool;
+    ball_pool_init(&single, 1);
+    ball_pool_init(&pool, threads);
+
+    printf("%10s %12s %16s %12s %16s   (%d threads)\n", "balls",
+           "1T ms/step", "1T updates/s", "ms/step", "updates/s", pool.threads);
+
+    for (int n = 1000; ; n *= 10) {
+        Balls balls;
+        double rate[2], ms[2];
+
+        if (n > max_balls)
+            n = max_balls;
+
+        if (!balls_init(&balls, n, 4)) {
+            printf("Out of memory for %d balls\n", n);
+            balls_free(&balls);
+            break;
+        }
+
+        for (int p = 0; p < 2; p++) {
+            int steps = 0;
+            Uint64 start = SDL_GetPerformanceCounter();
+            double elapsed = 0.0;
+
+            while (steps < 3 || elapsed < 0.5) {
+                update_balls(&balls, p == 0 ? &single : &pool);
+                steps++;
+                elapsed = (SDL_GetPerformanceCounter() - start) / freq;
+            }
+            rate[p] = (double)n * steps / elapsed;
+            ms[p] = elapsed * 1000.0 / steps;
+        }
+
+        printf("%10d %12.3f %16.0f %12.3f %16.0f\n",
+               n, ms[0], rate[0], ms[1], rate[1]);
+        balls_free(&balls);
+
+        if (n == max_balls)
+            break;
+    }
+
+    ball_pool_destroy(&single);
+    ball_pool_destroy(&pool);
+    return 0;
+}
+
+// renders frame_count frames into an offscreen surface as fast as possible
+int run_headless(int frame_count, int ball_count, int radius,
+                 int show_stages, const char *dump_dir) {
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    if (!renderer) {
+        printf("Offscreen renderer failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+
+    Balls balls;
+    if (!balls_init(&balls, ball_count, radius)) {
+        printf("Out of memory for %d balls\n", ball_count);
+        return 1;
+    }
+
+    BallPool pool;
+    ball_pool_init(&pool, SDL_GetCPUCount());
+
+    BallGrid grid;
+    BallSprite sprite;
+    if (!grid_init(&grid, &balls) ||
+        !sprite_init(&sprite, renderer, balls.radius, balls.count)) {
+        printf("Setup failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    FrameTimer timer;
+    frame_timer_init(&timer, frame_count);
+
+    for (int f = 0; f < frame_count; f++) {
+        frame_timer_skip(&timer);
+
+        update_balls(&balls, &pool);
+        collide_balls(&balls, &grid);
+        frame_timer_stage(&timer, STAGE_UPDATE);
+
+        draw_balls(renderer, &balls, &sprite);
+        frame_timer_stage(&timer, STAGE_RASTER);
+
+        SDL_RenderPresent(renderer);
+        frame_timer_stage(&timer, STAGE_PRESENT);
+
+        timer.frames++;
+
+        if (dump_dir) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/frame_%05d.ppm", dump_dir, f);
+            if (!save_ppm(surface, path))
+                printf("Could not write %s\n", path);
+        }
+    }
+
+    print_frame_stats(&timer, show_stages);
+
+    frame_timer_free(&timer);
+    sprite_free(&sprite);
+    grid_free(&grid);
+    ball_pool_destroy(&pool);
+    balls_free(&balls);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    return 0;
+}
+
+int main(int argc, char *argv[])
 {
-    SDL_Init(SDL_INIT_VIDEO);
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        int max_balls = (argc > 2) ? atoi(argv[2]) : 10000000;
+        int threads = (argc > 3) ? atoi(argv[3]) : SDL_GetCPUCount();
+        return run_benchmark(max_balls >= 1000 ? max_balls : 1000, threads);
+    }
 
-    const int WIDTH  = 800;
-    const int HEIGHT = 600;
+    if (argc > 1 && strcmp(argv[1], "--collide-bench") == 0)
+        return run_collide_benchmark();
+
+    if (argc > 1 && strcmp(argv[1], "--draw-bench") == 0) {
+        int radius = (argc > 2) ? atoi(argv[2]) : 24;
+        return run_draw_benchmark(radius > 6 ? radius : 24);
+    }
+
+    if (argc > 2 && strcmp(argv[1], "--headless") == 0) {
+        int ball_count = 1;
+        int radius = 24;
+        int show_stages = 0;
+        const char *dump_dir = NULL;
+
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--stages") == 0)
+                show_stages = 1;
+            else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+                dump_dir = argv[++i];
+            else if (strcmp(argv[i], "--balls") == 0 && i + 1 < argc)
+                ball_count = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--radius") == 0 && i + 1 < argc)
+                radius = atoi(argv[++i]);
+        }
+
+        int frames = atoi(argv[2]);
+        return run_headless(frames > 0 ? frames : 1,
+                            ball_count > 0 ? ball_count : 1,
+                            radius > 6 ? radius : 24, show_stages, dump_dir);
+    }
+
+    int ball_count = (argc > 1) ? atoi(argv[1]) : 1;
+    int radius = (argc > 2) ? atoi(argv[2]) : 24;
+
+    SDL_Init(SDL_INIT_VIDEO);
 
     SDL_Window *window = SDL_CreateWindow(
         "Red Ball with Orange Trail",
@@ -20,24 +1045,42 @@ int main(void)
     );
 
     SDL_Renderer *renderer = SDL_CreateRenderer(
-        window, -1, SDL_RENDERER_ACCELERATED
+        window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
     );
 
+    // without vsync the loop would spin; a 1 ms nap per frame is enough
+    SDL_RendererInfo info;
+    int vsync = SDL_GetRendererInfo(renderer, &info) == 0 &&
+                (info.flags & SDL_RENDERER_PRESENTVSYNC);
+
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
 
-    
-    float x = 200.0f;
-    float y = 120.0f;
-    float vx = 16.0f;     
-    float vy = -14.0f;
-    float gravity = 0.75f;
 
-    int radius = 24;
+    Balls balls;
+    if (ball_count <= 0 || !balls_init(&balls, ball_count, radius > 6 ? radius : 24)) {
+        printf("Could not allocate %d balls\n", ball_count);
+        return 1;
+    }
+
+    BallPool pool;
+    ball_pool_init(&pool, SDL_GetCPUCount());
+
+    BallGrid grid;
+    BallSprite sprite;
+    BallLerp lerp;
+    if (!grid_init(&grid, &balls) || !lerp_init(&lerp, &balls) ||
+        !sprite_init(&sprite, renderer, balls.radius, balls.count)) {
+        printf("Setup failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    FixedClock clock;
+    fixed_clock_init(&clock, SIM_HZ);
 
     int running = 1;
     SDL_Event event;
 
-    
+
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
     SDL_RenderPresent(renderer);
@@ -48,59 +1091,29 @@ int main(void)
                 running = 0;
         }
 
-        
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 14);
-        SDL_RenderFillRect(renderer, NULL);
-
-        
-        x += vx;
-        y += vy;
-        vy += gravity;
-
-        
-        if (y + radius >= HEIGHT) {
-            y = HEIGHT - radius;
-            vy = -vy * 0.96f;   
+        int steps = fixed_clock_begin(&clock);
+        for (int s = 0; s < steps; s++) {
+            lerp_save(&lerp, &balls);
+            update_balls(&balls, &pool);
+            collide_balls(&balls, &grid);
         }
+        fixed_clock_sim_done(&clock);
 
-        
-        if (x - radius <= 0 || x + radius >= WIDTH) {
-            vx = -vx;
-        }
-
-        
-        SDL_SetRenderDrawColor(renderer, 255, 140, 0, 80);
-        for (int dy = -radius; dy <= radius; dy++) {
-            for (int dx = -radius; dx <= radius; dx++) {
-                if (dx*dx + dy*dy <= radius*radius) {
-                    SDL_RenderDrawPoint(
-                        renderer,
-                        (int)(x + dx),
-                        (int)(y + dy)
-                    );
-                }
-            }
-        }
-
-        
-        int core = radius - 6;
-        SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-        for (int dy = -core; dy <= core; dy++) {
-            for (int dx = -core; dx <= core; dx++) {
-                if (dx*dx + dy*dy <= core*core) {
-                    SDL_RenderDrawPoint(
-                        renderer,
-                        (int)(x + dx),
-                        (int)(y + dy)
-                    );
-                }
-            }
-        }
+        Balls view = lerp_blend(&lerp, &balls, (float)fixed_clock_alpha(&clock));
+        draw_balls(renderer, &view, &sprite);
 
         SDL_RenderPresent(renderer);
-        SDL_Delay(16); 
+        fixed_clock_end(&clock);
+
+        if (!vsync)
+            SDL_Delay(1);
     }
 
+    lerp_free(&lerp);
+    sprite_free(&sprite);
+    grid_free(&grid);
+    ball_pool_destroy(&pool);
+    balls_free(&balls);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
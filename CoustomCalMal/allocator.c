@@ -0,0 +1,268 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#define _DEFAULT_SOURCE     // MAP_ANONYMOUS under -std=c99
+#include <sys/mman.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "allocator.h"
+
+static void* arena = NULL;
+static size_t arena_size = 0;
+static Block* free_list = NULL;
+static int quiet = 0;
+
+// every trace line goes through here, so quiet mode costs one branch
+#define LOG(...) do { if (!quiet) printf(__VA_ARGS__); } while (0)
+
+
+
+void print_blocks(void) { // will act as a book or journal
+    Block* curr = free_list;
+    int i = 0;
+
+    printf("\n[BLOCK LIST]\n");
+    while (curr) {
+        printf(
+            "Block %d | header=%p | user=%p | size=%zu | free=%d | next=%p\n",
+            i,
+            (void*)curr,
+            (void*)(curr + 1),
+            curr->size,
+            curr->free,
+            (void*)curr->next
+        );
+        curr = curr->next;
+        i++;
+    }
+    printf("\n");
+}
+
+
+
+void allocator_set_quiet(int q) {
+    quiet = q;
+}
+
+
+
+void allocator_release(void) {
+    if (!arena)
+        return;
+
+#ifdef _WIN32
+    VirtualFree(arena, 0, MEM_RELEASE);
+#else
+    munmap(arena, arena_size);
+#endif
+    arena = NULL;
+    arena_size = 0;
+    free_list = NULL;
+}
+
+
+
+void allocator_init(size_t size) {
+    allocator_release();
+
+#ifdef _WIN32
+    arena = VirtualAlloc(
+        NULL,
+        size,
+        MEM_RESERVE | MEM_COMMIT, //window make it necessary to add MEM_COMMIT and MEM_RESERVE together
+        PAGE_READWRITE
+    );
+
+    if (!arena) {
+        fprintf(stderr, "VirtualAlloc failed\n");
+        ExitProcess(1);
+    }
+#else
+    // Linux and friends: anonymous pages, zero-filled and committed lazily
+    // on first touch, which is the MEM_COMMIT step done by the kernel
+    arena = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (arena == MAP_FAILED) {
+        arena = NULL;
+        perror("mmap failed");
+        exit(1);
+    }
+#endif
+    arena_size = size;
+
+    free_list = (Block*)arena;
+    free_list->size = size - sizeof(Block); //Like linklist header size and remaining size
+    free_list->free = 1;
+    free_list->next = NULL;
+
+    LOG("[INIT] arena=%p size=%zu\n", arena, size);
+    if (!quiet)
+        print_blocks();
+}
+
+
+
+void init_allocator(void) {
+    allocator_init(ARENA_SIZE);
+}
+
+
+
+void split_block(Block* block, size_t size) {
+    Block* new_block = (Block*)((char*)(block + 1) + size);
+
+    new_block->size = block->size - size - sizeof(Block);
+    new_block->free = 1;
+    new_block->next = block->next;
+
+    LOG(
+        "[SPLIT] block=%p -> new_block=%p | sizes: %zu / %zu\n",
+        (void*)block,
+        (void*)new_block,
+        size,
+        new_block->size
+    );
+
+    block->size = size;
+    block->next = new_block;
+}
+
+
+
+void* my_malloc(size_t size) {
+    if (!arena)
+        init_allocator();
+
+    size = ALIGN(size);
+    LOG("[MALLOC] request=%zu\n", size);
+
+    Block* curr = free_list;
+
+    while (curr) {
+        LOG(
+            "  checking block=%p | free=%d | size=%zu\n",
+            (void*)curr,
+            curr->free,
+            curr->size
+        );
+
+        if (curr->free && curr->size >= size) {
+            LOG("  -> ACCEPTED\n");
+
+            if (curr->size >= size + sizeof(Block) + ALIGNMENT)
+                split_block(curr, size);
+            else
+                LOG("  -> NO SPLIT (exact/near fit)\n");
+
+            curr->free = 0;
+
+            void* user_ptr = (void*)(curr + 1);
+            LOG(
+                "[MALLOC DONE] header=%p user=%p size=%zu\n",
+                (void*)curr,
+                user_ptr,
+                curr->size
+            );
+
+            if (!quiet)
+                print_blocks();
+            return user_ptr;
+        }
+
+        LOG("  -> REJECTED\n");
+        curr = curr->next;
+    }
+
+    LOG("[MALLOC FAIL] out of memory\n");
+    return NULL;
+}
+
+
+
+void coalesce(void) {
+    Block* curr = free_list;
+
+    while (curr && curr->next) { // free blacoks mnerge make it bigger
+        if (curr->free && curr->next->free) {
+            LOG(
+                "[COALESCE] %p + %p\n",
+                (void*)curr,
+                (void*)curr->next
+            );
+
+            curr->size += sizeof(Block) + curr->next->size;
+            curr->next = curr->next->next;
+        } else {
+            curr = curr->next;
+        }
+    }
+}
+
+
+
+void my_free(void* ptr) {
+    if (!ptr)
+        return;
+
+    Block* block = (Block*)ptr - 1;
+
+    LOG(
+        "[FREE] user=%p header=%p size=%zu\n",
+        ptr,
+        (void*)block,
+        block->size
+    );
+
+    block->free = 1;
+    coalesce();
+    if (!quiet)
+        print_blocks();
+}
+
+
+
+void* my_realloc(void* ptr, size_t size) {
+    if (!ptr)
+        return my_malloc(size);
+
+    if (size == 0) {
+        my_free(ptr);
+        return NULL;
+    }
+
+    Block* block = (Block*)ptr - 1;
+    size = ALIGN(size);
+    LOG("[REALLOC] user=%p size=%zu -> %zu\n", ptr, block->size, size);
+
+    if (block->size >= size)
+        return ptr; // already big enough
+
+    // The list is the arena in address order, so block->next starts right
+    // after this block's data. If it is free and big enough, grow into it.
+    Block* next = block->next;
+    if (next && next->free && block->size + sizeof(Block) + next->size >= size) {
+        LOG("  -> GROW IN PLACE into %p\n", (void*)next);
+
+        block->size += sizeof(Block) + next->size;
+        block->next = next->next;
+
+        if (block->size >= size + sizeof(Block) + ALIGNMENT)
+            split_block(block, size);
+        return ptr;
+    }
+
+    LOG("  -> MOVE\n");
+    void* moved = my_malloc(size);
+    if (!moved)
+        return NULL;
+
+    memcpy(moved, ptr, block->size);
+    my_free(ptr);
+    return moved;
+}
@@ -0,0 +1,33 @@
+#ifndef COUSTOMCALMAL_ALLOCATOR_H
+#define COUSTOMCALMAL_ALLOCATOR_H
+
+#include <stddef.h>
+
+#define ARENA_SIZE (1024 * 1024)
+#define ALIGNMENT 8
+#define ALIGN(x) (((x) + (ALIGNMENT - 1)) & ~(ALIGNMENT - 1))
+
+typedef struct Block {
+    size_t size;
+    int free;
+    struct Block* next;
+} Block;
+
+void print_blocks(void);
+
+// Maps an ARENA_SIZE arena; my_malloc calls it on first use.
+void init_allocator(void);
+
+// Drops the current arena (everything in it) and maps a fresh one of
+// arena_size bytes. Benchmarks use it to start every run from one free block.
+void allocator_init(size_t arena_size);
+void allocator_release(void);
+
+// quiet = 1 turns off the trace of every split, accept and merge
+void allocator_set_quiet(int quiet);
+
+void* my_malloc(size_t size);
+void* my_realloc(void* ptr, size_t size);
+void my_free(void* ptr);
+
+#endif
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "dynarray.h"
+
+// Where the array's storage comes from. Built with USE_CUSTOM_ALLOCATOR,
+// growth goes through the CoustomCalMal arena instead of the C heap.
+#ifdef USE_CUSTOM_ALLOCATOR
+#include "allocator.h"
+#define DA_REALLOC my_realloc
+#define DA_FREE    my_free
+#else
+#define DA_REALLOC realloc
+#define DA_FREE    free
+#endif
+
+
+void da_init(DynArray *da) {
+    da->data = NULL;
+    da->size = 0;
+    da->capacity = 0;
+}
+
+
+int da_reserve(DynArray *da, size_t new_capacity) {
+    if (new_capacity <= da->capacity)
+        return 1;
+
+    int *new_data = (int *)DA_REALLOC(da->data, new_capacity * sizeof(int));
+    if (!new_data)
+        return 0; 
+
+    da->data = new_data;
+    da->capacity = new_capacity;
+    return 1;
+}
+
+
+int da_push(DynArray *da, int value) {
+    if (da->size == da->capacity) {
+        size_t new_capacity = (da->capacity == 0) ? 4 : da->capacity * 2;
+        if (!da_reserve(da, new_capacity))
+            return 0;
+    }
+
+    da->data[da->size++] = value;
+    return 1;
+}
+
+
+int da_pop(DynArray *da, int *out) {
+    if (da->size == 0)
+        return 0;
+
+    da->size--;
+    if (out)
+        *out = da->data[da->size];
+
+    return 1;
+}
+
+
+int da_get(const DynArray *da, size_t index, int *out) {
+    if (index >= da->size)
+        return 0;
+
+    *out = da->data[index];
+    return 1;
+}
+
+
+int da_set(DynArray *da, size_t index, int value) {
+    if (index >= da->size)
+        return 0;
+
+    da->data[index] = value;
+    return 1;
+}
+
+
+int da_insert(DynArray *da, size_t index, int value) {
+    if (index > da->size)
+        return 0;
+
+    if (da->size == da->capacity) {
+        size_t new_capacity = (da->capacity == 0) ? 4 : da->capacity * 2;
+        if (!da_reserve(da, new_capacity))
+            return 0;
+    }
+
+    for (size_t i = da->size; i > index; i--) {
+        da->data[i] = da->data[i - 1];
+    }
+
+    da->data[index] = value;
+    da->size++;
+    return 1;
+}
+
+
+int da_remove(DynArray *da, size_t index) {
+    if (index >= da->size)
+        return 0;
+
+    for (size_t i = index; i + 1 < da->size; i++) {
+        da->data[i] = da->data[i + 1];
+    }
+
+    da->size--;
+    return 1;
+}
+
+
+void da_free(DynArray *da) {
+    DA_FREE(da->data);
+    da->data = NULL;
+    da->size = 0;
+    da->capacity = 0;
+}
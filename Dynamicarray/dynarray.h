@@ -0,0 +1,22 @@
+#ifndef DYNARRAY_H
+#define DYNARRAY_H
+
+#include <stddef.h>
+
+typedef struct {
+    int    *data;
+    size_t size;
+    size_t capacity;
+} DynArray;
+
+void da_init(DynArray *da);
+int da_reserve(DynArray *da, size_t new_capacity);
+int da_push(DynArray *da, int value);
+int da_pop(DynArray *da, int *out);
+int da_get(const DynArray *da, size_t index, int *out);
+int da_set(DynArray *da, size_t index, int value);
+int da_insert(DynArray *da, size_t index, int value);
+int da_remove(DynArray *da, size_t index);
+void da_free(DynArray *da);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef HASHTABLE_H
+#define HASHTABLE_H
+
+#include <stdbool.h>
+
+#define MAX_NAME_LENGTH 250
+#define TABLE_SIZE 100
+
+typedef struct {
+    char name[MAX_NAME_LENGTH];
+    int age;
+} Person;
+
+typedef struct {
+    Person data[TABLE_SIZE];
+    bool occupied[TABLE_SIZE];
+} HashTable;
+
+unsigned int hash(const char *name);
+
+void ht_init(HashTable *ht);
+bool ht_insert(HashTable *ht, const char *name, int age);
+bool ht_get(HashTable *ht, const char *name, Person *out);
+void ht_print(HashTable *ht);
+
+// A table on the heap, already initialized; NULL if out of memory
+HashTable *ht_create(void);
+void ht_destroy(HashTable *ht);
+
+#endif
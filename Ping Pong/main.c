@@ -1,8 +1,12 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#include "../common/frame_stats.h"
+
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
 
@@ -12,6 +16,15 @@
 
 #define BALL_SIZE      15
 #define BALL_SPEED     4.0f
+#define MAX_BOUNCES    8      // surfaces the ball may hit within one step
+
+#define MAX_THREADS     64
+#define MATCH_POINTS    11
+#define MAX_MATCH_STEPS 500000    // in steps of dt 1; longer matches are draws
+#define MIN_DT          0.001f    // keeps a match under a billion steps
+
+#define SIM_HZ         60     // simulation steps per second
+#define MAX_FRAME_TIME 0.25   // longest frame the clock will catch up on
 
 
 typedef enum {
@@ -20,88 +33,396 @@ typedef enum {
     GAME_PAUSE
 } GameState;
 
+// The ball's top-left corner and velocity in float pixels per step. Only the
+// drawing rounds it to an SDL_Rect, so speed and angle never drift.
+typedef struct {
+    float x, y;
+    float vx, vy;
+} Ball;
+
+// A paddle's top-left corner in float pixels, PADDLE_WIDTH x PADDLE_HEIGHT.
+// Like the ball it moves by PADDLE_SPEED * dt exactly, whatever the dt, and
+// only the drawing rounds it.
+typedef struct {
+    float x, y;
+} Paddle;
+
+// The digits 0-9 rasterized once, at startup, into one texture. A score is
+// drawn as one quad per digit cut out of it, so no glyph is rendered and no
+// texture is created while the game runs.
+typedef struct {
+    SDL_Texture *texture;
+    SDL_Rect glyph[10];
+} DigitAtlas;
 
-void move_paddle(SDL_Rect *p, int dy) {
+// the digit quads of one score, laid out again only when the value changes
+typedef struct {
+    int value;          // -1 until the first layout
+    int len;
+    SDL_Rect src[11];
+    SDL_Rect dst[11];   // relative to the score's position
+} ScoreText;
+
+typedef struct {
+    DigitAtlas digits;
+    ScoreText score[2];
+} Scoreboard;
+
+// Fixed-timestep clock: real time goes into an accumulator, which is paid
+// out in whole simulation steps of dt. The renderer draws whatever is left
+// over as a blend between the last two states, so the simulation runs at
+// SIM_HZ whatever the display does. A slow frame is followed by several
+// steps and no extra frames: frames get dropped, steps never do.
+typedef struct {
+    double dt;              // seconds per simulation step
+    double accumulator;     // real time not simulated yet
+    double freq;
+    Uint64 last;            // start of the previous frame
+    Uint64 mark;            // start of the current frame
+    // counters for the current one-second report
+    Uint64 report_start;
+    int steps;
+    int frames;
+    int dropped;            // frames skipped because a frame ran > 1 step
+    int lost;               // steps given up after a stall (see MAX_FRAME_TIME)
+    double sim_ms;
+    double frame_ms;
+    double frame_ms_max;
+} FixedClock;
+
+void fixed_clock_init(FixedClock *clock, int hz) {
+    memset(clock, 0, sizeof(*clock));
+    clock->dt = 1.0 / hz;
+    clock->freq = (double)SDL_GetPerformanceFrequency();
+    clock->last = clock->report_start = SDL_GetPerformanceCounter();
+}
+
+// Starts a frame and returns how many simulation steps it has to run.
+// Only a stall longer than MAX_FRAME_TIME (a debugger, a dragged window)
+// gives up time, and the steps it gives up are counted.
+int fixed_clock_begin(FixedClock *clock) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    double elapsed = (now - clock->last) / clock->freq;
+    clock->last = clock->mark = now;
+
+    if (elapsed > MAX_FRAME_TIME) {
+        clock->lost += (int)((elapsed - MAX_FRAME_TIME) / clock->dt);
+        elapsed = MAX_FRAME_TIME;
+    }
+
+    clock->accumulator += elapsed;
+    int steps = (int)(clock->accumulator / clock->dt);
+    clock->accumulator -= steps * clock->dt;
+
+    clock->steps += steps;
+    if (steps > 1)
+        clock->dropped += steps - 1;
+    return steps;
+}
+
+// how far the next, not yet simulated, step is: 0 draws the previous state
+double fixed_clock_alpha(const FixedClock *clock) {
+    return clock->accumulator / clock->dt;
+}
+
+// charge the time since the frame started to the simulation
+void fixed_clock_sim_done(FixedClock *clock) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    clock->sim_ms += (now - clock->mark) * 1000.0 / clock->freq;
+    clock->mark = now;
+}
+
+// ends a frame; prints and resets the counters once a second
+void fixed_clock_end(FixedClock *clock) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    double ms = (now - clock->last) * 1000.0 / clock->freq;
+
+    clock->frames++;
+    clock->frame_ms += ms;
+    if (ms > clock->frame_ms_max)
+        clock->frame_ms_max = ms;
+
+    double window = (now - clock->report_start) / clock->freq;
+    if (window < 1.0)
+        return;
+
+    printf("sim %5.1f steps/s %6.3f ms/step | %5.1f fps %6.2f ms avg %6.2f max"
+           " | dropped %d lost %d\n",
+           clock->steps / window,
+           clock->steps ? clock->sim_ms / clock->steps : 0.0,
+           clock->frames / window, clock->frame_ms / clock->frames,
+           clock->frame_ms_max, clock->dropped, clock->lost);
+
+    clock->report_start = now;
+    clock->steps = clock->frames = clock->dropped = clock->lost = 0;
+    clock->sim_ms = clock->frame_ms = clock->frame_ms_max = 0.0;
+}
+
+void move_paddle(Paddle *p, float dy) {
     p->y += dy;
 
-    if (p->y < 0)
-        p->y = 0;
-    if (p->y + p->h > WINDOW_HEIGHT)
-        p->y = WINDOW_HEIGHT - p->h;
+    if (p->y < 0.0f)
+        p->y = 0.0f;
+    if (p->y + PADDLE_HEIGHT > WINDOW_HEIGHT)
+        p->y = WINDOW_HEIGHT - PADDLE_HEIGHT;
+}
+
+SDL_Rect paddle_rect(const Paddle *p) {
+    SDL_Rect r = {
+        (int)floorf(p->x + 0.5f), (int)floorf(p->y + 0.5f),
+        PADDLE_WIDTH, PADDLE_HEIGHT
+    };
+    return r;
 }
 
 
-void reset_ball(SDL_Rect *ball, float *vx, float *vy, int dir) {
+void reset_ball(Ball *ball, int dir) {
     ball->x = (WINDOW_WIDTH - BALL_SIZE) / 2;
     ball->y = (WINDOW_HEIGHT - BALL_SIZE) / 2;
 
-    *vx = dir * BALL_SPEED;
-    *vy = 0.0f;
+    ball->vx = dir * BALL_SPEED;
+    ball->vy = 0.0f;
+}
+
+SDL_Rect ball_rect(const Ball *ball) {
+    SDL_Rect r = {
+        (int)floorf(ball->x + 0.5f), (int)floorf(ball->y + 0.5f),
+        BALL_SIZE, BALL_SIZE
+    };
+    return r;
 }
 
-void move_ball(SDL_Rect *b, float *vx, float *vy,
-               SDL_Rect *p1, SDL_Rect *p2,
-               int *score1, int *score2,
-               GameState *state)
+// Sends the ball back from paddle p toward the other side: the further
+// from the paddle's centre it hits, the steeper the angle. The speed
+// stays BALL_SPEED.
+static void paddle_bounce(Ball *b, const Paddle *p, float dir) {
+    float pc = p->y + PADDLE_HEIGHT / 2.0f;
+    float bc = b->y + BALL_SIZE / 2.0f;
+    float offset = (bc - pc) / (PADDLE_HEIGHT / 2.0f);
+
+    float vx = dir * BALL_SPEED;
+    float vy = offset * BALL_SPEED;
+    float len = sqrtf(vx * vx + vy * vy);
+
+    b->vx = vx / len * BALL_SPEED;
+    b->vy = vy / len * BALL_SPEED;
+}
+
+// Swept test of the ball's corner moving by (dx, dy) against paddle p grown
+// by the ball's size, which is the same as the ball's box against p. Returns
+// the entry time in [0, 1], or -1 when it misses or is moving away, and
+// reports whether a side face (rather than the top or bottom) was hit.
+static float sweep_paddle(const Ball *b, float dx, float dy,
+                          const Paddle *p, int *side)
 {
-    b->x += (int)(*vx);
-    b->y += (int)(*vy);
+    float x0 = p->x - BALL_SIZE, x1 = p->x + PADDLE_WIDTH;
+    float y0 = p->y - BALL_SIZE, y1 = p->y + PADDLE_HEIGHT;
+    float tx0, tx1, ty0, ty1;
 
-    
-    if (b->y <= 0) {
-        b->y = 0;
-        *vy = -*vy;
+    if (dx != 0.0f) {
+        tx0 = (x0 - b->x) / dx;
+        tx1 = (x1 - b->x) / dx;
+        if (tx0 > tx1) { float t = tx0; tx0 = tx1; tx1 = t; }
+    } else if (b->x > x0 && b->x < x1) {
+        tx0 = -INFINITY; tx1 = INFINITY;
+    } else {
+        return -1.0f;
     }
-    if (b->y + b->h >= WINDOW_HEIGHT) {
-        b->y = WINDOW_HEIGHT - b->h;
-        *vy = -*vy;
+
+    if (dy != 0.0f) {
+        ty0 = (y0 - b->y) / dy;
+        ty1 = (y1 - b->y) / dy;
+        if (ty0 > ty1) { float t = ty0; ty0 = ty1; ty1 = t; }
+    } else if (b->y > y0 && b->y < y1) {
+        ty0 = -INFINITY; ty1 = INFINITY;
+    } else {
+        return -1.0f;
     }
 
-    
-    if (SDL_HasIntersection(b, p1)) {
-        b->x = p1->x + p1->w;
+    float enter = tx0 > ty0 ? tx0 : ty0;
+    float leave = tx1 < ty1 ? tx1 : ty1;
 
-        float pc = p1->y + p1->h / 2.0f;
-        float bc = b->y + b->h / 2.0f;
-        float offset = (bc - pc) / (p1->h / 2.0f);
+    // touching a face while moving away from it is not a hit, which is
+    // what keeps a ball resting on a face from bouncing again
+    if (enter >= leave || leave <= 0.0f || enter < 0.0f || enter > 1.0f)
+        return -1.0f;
 
-        *vx = BALL_SPEED;
-        *vy = offset * BALL_SPEED;
-    }
+    *side = tx0 > ty0;
+    return enter;
+}
 
-    
-    if (SDL_HasIntersection(b, p2)) {
-        b->x = p2->x - b->w;
+static int overlaps(const Ball *b, const Paddle *p) {
+    return b->x < p->x + PADDLE_WIDTH && b->x + BALL_SIZE > p->x &&
+           b->y < p->y + PADDLE_HEIGHT && b->y + BALL_SIZE > p->y;
+}
 
-        float pc = p2->y + p2->h / 2.0f;
-        float bc = b->y + b->h / 2.0f;
-        float offset = (bc - pc) / (p2->h / 2.0f);
+// Advances the ball by dt steps with continuous collision: each pass finds
+// the earliest wall or paddle face the ball's path crosses, moves it there,
+// bounces, and spends the rest of the step on the new heading. Fast balls
+// and large dt can no longer pass through a paddle between two samples.
+// Returns how many times a paddle sent the ball back.
+int move_ball(Ball *b, float dt,
+              const Paddle *p1, const Paddle *p2,
+              int *score1, int *score2,
+              GameState *state)
+{
+    const Paddle *paddle[2] = { p1, p2 };
+    float away[2] = { 1.0f, -1.0f };
+    int returns = 0;
 
-        *vx = -BALL_SPEED;
-        *vy = offset * BALL_SPEED;
+    // a paddle that moved into the resting ball knocks it away, like before
+    for (int k = 0; k < 2; k++) {
+        if (overlaps(b, paddle[k])) {
+            b->x = k == 0 ? p1->x + PADDLE_WIDTH : p2->x - BALL_SIZE;
+            paddle_bounce(b, paddle[k], away[k]);
+            returns++;
+        }
     }
 
-    
-    float len = sqrtf((*vx)*(*vx) + (*vy)*(*vy));
-    if (len != 0.0f) {
-        *vx = (*vx / len) * BALL_SPEED;
-        *vy = (*vy / len) * BALL_SPEED;
+    float left = 1.0f;   // fraction of the step still to move
+
+    for (int bounce = 0; bounce < MAX_BOUNCES && left > 0.0f; bounce++) {
+        float dx = b->vx * dt * left;
+        float dy = b->vy * dt * left;
+        float t = 1.0f;
+        int hit = -1;       // 0/1 paddle, 2 top wall, 3 bottom wall
+        int side = 0;
+
+        if (dy < 0.0f && b->y + dy < 0.0f) {
+            t = -b->y / dy;
+            hit = 2;
+        } else if (dy > 0.0f && b->y + dy > WINDOW_HEIGHT - BALL_SIZE) {
+            t = (WINDOW_HEIGHT - BALL_SIZE - b->y) / dy;
+            hit = 3;
+        }
+
+        for (int k = 0; k < 2; k++) {
+            int k_side;
+            float tk = sweep_paddle(b, dx, dy, paddle[k], &k_side);
+            if (tk >= 0.0f && tk < t) {
+                t = tk;
+                hit = k;
+                side = k_side;
+            }
+        }
+
+        b->x += dx * t;
+        b->y += dy * t;
+        left *= 1.0f - t;
+
+        if (hit < 0)
+            break;
+
+        // snap onto the face so rounding can't leave the ball inside it
+        if (hit == 2) {
+            b->y = 0.0f;
+            b->vy = -b->vy;
+        } else if (hit == 3) {
+            b->y = WINDOW_HEIGHT - BALL_SIZE;
+            b->vy = -b->vy;
+        } else if (side) {
+            const Paddle *p = paddle[hit];
+            b->x = hit == 0 ? p->x + PADDLE_WIDTH : p->x - BALL_SIZE;
+            paddle_bounce(b, p, away[hit]);
+            returns++;
+        } else {
+            const Paddle *p = paddle[hit];
+            b->y = b->vy > 0.0f ? p->y - BALL_SIZE : p->y + PADDLE_HEIGHT;
+            b->vy = -b->vy;
+        }
     }
 
-    
     if (b->x < 0) {
         (*score2)++;
-        reset_ball(b, vx, vy, -1);
+        reset_ball(b, -1);
         *state = GAME_WAIT;
     }
     if (b->x > WINDOW_WIDTH) {
         (*score1)++;
-        reset_ball(b, vx, vy, 1);
+        reset_ball(b, 1);
         *state = GAME_WAIT;
     }
+    return returns;
+}
+
+
+// Everything one game needs, with no SDL window or input attached, so the
+// same update drives the window, the headless frames and the self-play.
+typedef struct {
+    Paddle p1, p2;
+    Ball ball;
+    int score1, score2;
+    GameState state;
+    Uint32 seed;        // for policies and serves that want randomness
+    Uint32 rng;
+    int returns;        // paddle hits so far
+    float dt;           // length of the step the policies are asked about
+} Match;
+
+// A paddle controller: the move it wants this step, in pixels per unit of
+// dt. The step clamps it to PADDLE_SPEED, so no policy can cheat.
+typedef float (*PaddlePolicy)(const Match *m, int side);
+
+void match_init(Match *m, Uint32 seed) {
+    Paddle p1 = { 40, (WINDOW_HEIGHT - PADDLE_HEIGHT)/2 };
+    Paddle p2 = { WINDOW_WIDTH - 40 - PADDLE_WIDTH,
+                  (WINDOW_HEIGHT - PADDLE_HEIGHT)/2 };
+
+    memset(m, 0, sizeof(*m));
+    m->p1 = p1;
+    m->p2 = p2;
+    reset_ball(&m->ball, 1);
+    m->state = GAME_WAIT;
+    m->seed = seed;
+    m->rng = seed ? seed : 1;
+}
+
+// lowbias32 integer hash
+Uint32 hash32(Uint32 h) {
+    h ^= h >> 16; h *= 0x7FEB352Du;
+    h ^= h >> 15; h *= 0x846CA68Bu;
+    return h ^ (h >> 16);
 }
 
+Uint32 match_random(Match *m) {
+    m->rng ^= m->rng << 13;
+    m->rng ^= m->rng >> 17;
+    m->rng ^= m->rng << 5;
+    return m->rng;
+}
+
+// Starts the waiting ball at a random angle of up to 30 degrees, so two
+// perfect players don't replay the same rally forever.
+void match_serve(Match *m) {
+    float angle = ((match_random(m) >> 8) / 16777216.0f - 0.5f) * 1.0472f;
+    float dir = m->ball.vx < 0.0f ? -1.0f : 1.0f;
+
+    m->ball.vx = dir * BALL_SPEED * cosf(angle);
+    m->ball.vy = BALL_SPEED * sinf(angle);
+    m->state = GAME_PLAY;
+}
 
+// one simulation step: both paddles, then the ball if it is in play
+void match_step(Match *m, PaddlePolicy left, PaddlePolicy right, float dt) {
+    float limit = PADDLE_SPEED * dt;
+    m->dt = dt;
+    float dy[2] = { left(m, 0), right(m, 1) };
+
+    for (int k = 0; k < 2; k++) {
+        float d = dy[k] * dt;
+        d = d < -limit ? -limit : (d > limit ? limit : d);
+        if (d != 0.0f)
+            move_paddle(k == 0 ? &m->p1 : &m->p2, d);
+    }
+
+    if (m->state == GAME_PLAY)
+        m->returns += move_ball(&m->ball, dt, &m->p1, &m->p2,
+                                &m->score1, &m->score2, &m->state);
+}
+
+
+// The original score drawing: a glyph render, a texture upload and two
+// frees per call. Only kept for --text-bench.
 void draw_text(SDL_Renderer *renderer, TTF_Font *font,
                int value, int x, int y)
 {
@@ -122,8 +443,532 @@ void draw_text(SDL_Renderer *renderer, TTF_Font *font,
 }
 
 
+// Renders "0123456789" once and finds each digit's column from the width
+// of the text before it, which is where TTF puts it inside the string.
+int digit_atlas_init(DigitAtlas *atlas, SDL_Renderer *renderer, TTF_Font *font)
+{
+    const char *digits = "0123456789";
+    SDL_Color white = {255, 255, 255, 255};
+
+    SDL_Surface *surface = TTF_RenderText_Solid(font, digits, white);
+    if (!surface)
+        return 0;
+
+    for (int d = 0; d < 10; d++) {
+        char prefix[11];
+        char digit[2] = { digits[d], 0 };
+        int x = 0, w = 0;
+
+        memcpy(prefix, digits, d);
+        prefix[d] = 0;
+        if (d > 0)
+            TTF_SizeText(font, prefix, &x, NULL);
+        TTF_SizeText(font, digit, &w, NULL);
+
+        SDL_Rect glyph = { x, 0, w, surface->h };
+        atlas->glyph[d] = glyph;
+    }
+
+    atlas->texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    return atlas->texture != NULL;
+}
+
+void digit_atlas_free(DigitAtlas *atlas)
+{
+    if (atlas->texture)
+        SDL_DestroyTexture(atlas->texture);
+    atlas->texture = NULL;
+}
+
+int scoreboard_init(Scoreboard *board, SDL_Renderer *renderer, TTF_Font *font)
+{
+    board->score[0].value = board->score[1].value = -1;
+    return digit_atlas_init(&board->digits, renderer, font);
+}
+
+// lays out the digits of value left to right from the atlas
+void score_text_layout(ScoreText *text, const DigitAtlas *atlas, int value)
+{
+    char buf[16];
+    int x = 0;
+
+    snprintf(buf, sizeof(buf), "%d", value);
+    text->value = value;
+    text->len = 0;
+
+    for (int i = 0; buf[i] && text->len < 11; i++) {
+        if (buf[i] < '0' || buf[i] > '9')
+            continue;
+
+        SDL_Rect src = atlas->glyph[buf[i] - '0'];
+        SDL_Rect dst = { x, 0, src.w, src.h };
+        text->src[text->len] = src;
+        text->dst[text->len] = dst;
+        text->len++;
+        x += src.w;
+    }
+}
+
+void draw_score(SDL_Renderer *renderer, const DigitAtlas *atlas,
+                ScoreText *text, int value, int x, int y)
+{
+    if (text->value != value)
+        score_text_layout(text, atlas, value);
+
+    for (int i = 0; i < text->len; i++) {
+        SDL_Rect dst = text->dst[i];
+        dst.x += x;
+        dst.y += y;
+        SDL_RenderCopy(renderer, atlas->texture, &text->src[i], &dst);
+    }
+}
+
+
+void draw_scene(SDL_Renderer *renderer, Scoreboard *board,
+                SDL_Rect *p1, SDL_Rect *p2, SDL_Rect *ball,
+                int score1, int score2)
+{
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderFillRect(renderer, p1);
+    SDL_RenderFillRect(renderer, p2);
+    SDL_RenderFillRect(renderer, ball);
+
+    draw_score(renderer, &board->digits, &board->score[0],
+               score1, WINDOW_WIDTH / 4, 20);
+    draw_score(renderer, &board->digits, &board->score[1],
+               score2, WINDOW_WIDTH * 3 / 4, 20);
+}
+
+
+// the paddle drawn alpha of the way from prev to cur
+SDL_Rect lerp_paddle(const Paddle *prev, const Paddle *cur, float alpha) {
+    Paddle p = *cur;
+    p.x = prev->x + (cur->x - prev->x) * alpha;
+    p.y = prev->y + (cur->y - prev->y) * alpha;
+    return paddle_rect(&p);
+}
+
+// the ball drawn alpha of the way from prev to cur
+SDL_Rect lerp_ball(const Ball *prev, const Ball *cur, float alpha) {
+    Ball b = *cur;
+    b.x = prev->x + (cur->x - prev->x) * alpha;
+    b.y = prev->y + (cur->y - prev->y) * alpha;
+    return ball_rect(&b);
+}
+
+
+static const Paddle *own_paddle(const Match *m, int side) {
+    return side == 0 ? &m->p1 : &m->p2;
+}
+
+// Up to speed toward target_y for the paddle's centre, stopping anywhere
+// within speed pixels of it. The move never runs past that dead zone, so
+// a longer dt only costs precision and the paddle never jitters.
+static float steer(const Match *m, const Paddle *p, int target_y, int speed) {
+    float off = target_y - (p->y + PADDLE_HEIGHT / 2.0f);
+
+    if (off > speed) off -= speed;
+    else if (off < -speed) off += speed;
+    else return 0.0f;
+
+    float want = off / m->dt;
+    return want < -speed ? -speed : (want > speed ? speed : want);
+}
+
+// W/S and Up/Down
+float keyboard_policy(const Match *m, int side) {
+    const Uint8 *keys = SDL_GetKeyboardState(NULL);
+    SDL_Scancode up = side == 0 ? SDL_SCANCODE_W : SDL_SCANCODE_UP;
+    SDL_Scancode down = side == 0 ? SDL_SCANCODE_S : SDL_SCANCODE_DOWN;
+    (void)m;
+
+    return (keys[down] ? PADDLE_SPEED : 0) - (keys[up] ? PADDLE_SPEED : 0);
+}
+
+// follows the ball's height, wherever it is
+float track_policy(const Match *m, int side) {
+    return steer(m, own_paddle(m, side), (int)(m->ball.y + BALL_SIZE / 2),
+                 PADDLE_SPEED);
+}
+
+// where the ball will cross x, folding its path off the top and bottom walls
+static float predict_y(const Ball *b, float x) {
+    float range = WINDOW_HEIGHT - BALL_SIZE;
+    float y = b->y + b->vy * ((x - b->x) / b->vx);
+
+    y = fmodf(y, 2.0f * range);
+    if (y < 0.0f) y += 2.0f * range;
+    if (y > range) y = 2.0f * range - y;
+    return y + BALL_SIZE / 2.0f;
+}
+
+// waits where the incoming ball will arrive, back to the middle otherwise
+float predict_policy(const Match *m, int side) {
+    const Paddle *p = own_paddle(m, side);
+    int incoming = side == 0 ? m->ball.vx < 0.0f : m->ball.vx > 0.0f;
+
+    if (!incoming || m->state != GAME_PLAY)
+        return steer(m, p, WINDOW_HEIGHT / 2, PADDLE_SPEED);
+
+    float face = side == 0 ? p->x + PADDLE_WIDTH : p->x - BALL_SIZE;
+    return steer(m, p, (int)predict_y(&m->ball, face), PADDLE_SPEED);
+}
+
+// predicts, but misjudges each rally by up to +-70 px; the error is a hash
+// of the match seed and the rally's hit count, so it needs no state
+float noisy_policy(const Match *m, int side) {
+    const Paddle *p = own_paddle(m, side);
+    int incoming = side == 0 ? m->ball.vx < 0.0f : m->ball.vx > 0.0f;
+
+    if (!incoming || m->state != GAME_PLAY)
+        return steer(m, p, WINDOW_HEIGHT / 2, PADDLE_SPEED);
+
+    Uint32 h = hash32(m->seed ^ (Uint32)m->returns * 0x9E3779B9u ^
+                      (Uint32)side * 0x85EBCA6Bu);
+    int error = (int)(h % 141) - 70;
+
+    float face = side == 0 ? p->x + PADDLE_WIDTH : p->x - BALL_SIZE;
+    return steer(m, p, (int)predict_y(&m->ball, face) + error, PADDLE_SPEED);
+}
+
+// only wakes up once the ball is in its own half, and moves at half speed
+float lazy_policy(const Match *m, int side) {
+    float bc = m->ball.x + BALL_SIZE / 2.0f;
+    int near = side == 0 ? bc < WINDOW_WIDTH / 2 : bc > WINDOW_WIDTH / 2;
+
+    if (!near)
+        return 0;
+    return steer(m, own_paddle(m, side), (int)(m->ball.y + BALL_SIZE / 2),
+                 PADDLE_SPEED / 2);
+}
+
+typedef struct {
+    const char *name;
+    PaddlePolicy policy;
+} NamedPolicy;
+
+static const NamedPolicy policies[] = {
+    { "track",   track_policy },
+    { "predict", predict_policy },
+    { "noisy",   noisy_policy },
+    { "lazy",    lazy_policy },
+};
+
+PaddlePolicy find_policy(const char *name) {
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+        if (strcmp(policies[i].name, name) == 0)
+            return policies[i].policy;
+    return NULL;
+}
+
+
+// a slice of the self-play matches and its totals; each thread owns one
+typedef struct {
+    PaddlePolicy left, right;
+    float dt;
+    int points;
+    Uint32 seed;
+    int first, last;        // matches [first, last)
+    int left_wins, right_wins, draws;
+    Sint64 left_points, right_points;
+    Sint64 returns;
+    Sint64 steps;
+} SelfPlayJob;
+
+// Plays the job's matches to completion. Match i is seeded from (seed, i)
+// alone, so the totals don't depend on how matches are split over threads.
+static int selfplay_worker(void *data) {
+    SelfPlayJob *job = data;
+    double max_steps = ceil(MAX_MATCH_STEPS / (double)job->dt);
+
+    for (int i = job->first; i < job->last; i++) {
+        Match m;
+        int steps = 0;
+        match_init(&m, hash32(job->seed + (Uint32)i * 0x9E3779B9u));
+
+        while (m.score1 < job->points && m.score2 < job->points &&
+               steps < max_steps) {
+            if (m.state == GAME_WAIT)
+                match_serve(&m);
+            match_step(&m, job->left, job->right, job->dt);
+            steps++;
+        }
+
+        if (m.score1 >= job->points) job->left_wins++;
+        else if (m.score2 >= job->points) job->right_wins++;
+        else job->draws++;
+
+        job->left_points += m.score1;
+        job->right_points += m.score2;
+        job->returns += m.returns;
+        job->steps += steps;
+    }
+    return 0;
+}
+
+// Plays match_count independent matches across threads and prints the
+// throughput and the aggregate results.
+int run_selfplay(int match_count, int threads, const char *left_name,
+                 const char *right_name, float dt, int points, Uint32 seed)
+{
+    PaddlePolicy left = find_policy(left_name);
+    PaddlePolicy right = find_policy(right_name);
+    if (!left || !right) {
+        printf("Unknown policy; choose from:");
+        for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+            printf(" %s", policies[i].name);
+        printf("\n");
+        return 1;
+    }
+
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    SelfPlayJob jobs[MAX_THREADS];
+    SDL_Thread *workers[MAX_THREADS];
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    for (int t = 0; t < threads; t++) {
+        SelfPlayJob *job = &jobs[t];
+        memset(job, 0, sizeof(*job));
+        job->left = left;
+        job->right = right;
+        job->dt = dt;
+        job->points = points;
+        job->seed = seed;
+        job->first = (int)((Sint64)match_count * t / threads);
+        job->last = (int)((Sint64)match_count * (t + 1) / threads);
+
+        // the calling thread plays the last slice itself
+        if (t < threads - 1)
+            workers[t] = SDL_CreateThread(selfplay_worker, "selfplay", job);
+    }
+    selfplay_worker(&jobs[threads - 1]);
+    for (int t = 0; t < threads - 1; t++)
+        SDL_WaitThread(workers[t], NULL);
+
+    double elapsed = (SDL_GetPerformanceCounter() - start) /
+                     (double)SDL_GetPerformanceFrequency();
+
+    SelfPlayJob total;
+    memset(&total, 0, sizeof(total));
+    for (int t = 0; t < threads; t++) {
+        total.left_wins += jobs[t].left_wins;
+        total.right_wins += jobs[t].right_wins;
+        total.draws += jobs[t].draws;
+        total.left_points += jobs[t].left_points;
+        total.right_points += jobs[t].right_points;
+        total.returns += jobs[t].returns;
+        total.steps += jobs[t].steps;
+    }
+
+    Sint64 rallies = total.left_points + total.right_points;
+
+    printf("%d matches to %d, %s vs %s, dt %.2f, %d threads, seed %u\n",
+           match_count, points, left_name, right_name, dt, threads, seed);
+    printf("%.3f s: %.0f matches/s, %.0f rallies/min, %.0f steps/s\n",
+           elapsed, match_count / elapsed, rallies * 60.0 / elapsed,
+           total.steps / elapsed);
+    printf("wins   %s %d, %s %d, unfinished %d\n",
+           left_name, total.left_wins, right_name, total.right_wins, total.draws);
+    printf("points %s %lld, %s %lld, %.1f returns per rally\n",
+           left_name, (long long)total.left_points,
+           right_name, (long long)total.right_points,
+           rallies ? (double)total.returns / rallies : 0.0);
+    return 0;
+}
+
+
+// Score drawing cost per frame, offscreen: the old per-frame glyph render
+// and upload against atlas quads. The scores change every 100 frames, about
+// as often as in a fast game, so the layout cache gets exercised too.
+int run_text_benchmark(int frame_count)
+{
+    TTF_Init();
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WINDOW_WIDTH, WINDOW_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    TTF_Font *font = TTF_OpenFont("arial.ttf", 32);
+    if (!renderer || !font) {
+        printf("Setup failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    Scoreboard board;
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (!scoreboard_init(&board, renderer, font)) {
+        printf("Score atlas failed: %s\n", SDL_GetError());
+        return 1;
+    }
+    double atlas_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 /
+                      SDL_GetPerformanceFrequency();
+
+    double *ms[2];
+    for (int path = 0; path < 2; path++) {
+        ms[path] = malloc(sizeof(double) * frame_count);
+
+        for (int f = 0; f < frame_count; f++) {
+            int score1 = f / 100;
+            int score2 = f / 150;
+
+            start = SDL_GetPerformanceCounter();
+            if (path == 0) {
+                draw_text(renderer, font, score1, WINDOW_WIDTH / 4, 20);
+                draw_text(renderer, font, score2, WINDOW_WIDTH * 3 / 4, 20);
+            } else {
+                draw_score(renderer, &board.digits, &board.score[0],
+                           score1, WINDOW_WIDTH / 4, 20);
+                draw_score(renderer, &board.digits, &board.score[1],
+                           score2, WINDOW_WIDTH * 3 / 4, 20);
+            }
+            ms[path][f] = (SDL_GetPerformanceCounter() - start) * 1000.0 /
+                          SDL_GetPerformanceFrequency();
+        }
+    }
+
+    printf("%d frames, atlas built once in %.3f ms\n", frame_count, atlas_ms);
+    printf("%-8s %9s %9s %9s\n", "text", "min ms", "p50 ms", "p99 ms");
+    print_times("render", ms[0], frame_count);
+    print_times("atlas", ms[1], frame_count);
+
+    free(ms[0]);
+    free(ms[1]);
+    digit_atlas_free(&board.digits);
+    TTF_CloseFont(font);
+    TTF_Quit();
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    return 0;
+}
+
+
+// plays frame_count frames offscreen with both paddles tracking the ball
+int run_headless(int frame_count, int show_stages, const char *dump_dir)
+{
+    TTF_Init();
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WINDOW_WIDTH, WINDOW_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    if (!renderer) {
+        printf("Offscreen renderer failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    TTF_Font *font = TTF_OpenFont("arial.ttf", 32);
+    if (!font) {
+        printf("FONT LOAD FAILED: %s\n", TTF_GetError());
+        return 1;
+    }
+
+    Scoreboard board;
+    if (!scoreboard_init(&board, renderer, font)) {
+        printf("Score atlas failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    // both paddles on track_policy, serving straight after each point
+    Match m;
+    match_init(&m, 1);
+    m.state = GAME_PLAY;
+
+    FrameTimer timer;
+    frame_timer_init(&timer, frame_count);
+
+    for (int f = 0; f < frame_count; f++) {
+        frame_timer_skip(&timer);
+
+        match_step(&m, track_policy, track_policy, 1.0f);
+        m.state = GAME_PLAY;
+        frame_timer_stage(&timer, STAGE_UPDATE);
+
+        SDL_Rect p1_box = paddle_rect(&m.p1), p2_box = paddle_rect(&m.p2);
+        SDL_Rect ball_box = ball_rect(&m.ball);
+        draw_scene(renderer, &board, &p1_box, &p2_box, &ball_box,
+                   m.score1, m.score2);
+        frame_timer_stage(&timer, STAGE_RASTER);
+
+        SDL_RenderPresent(renderer);
+        frame_timer_stage(&timer, STAGE_PRESENT);
+
+        timer.frames++;
+
+        if (dump_dir) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/frame_%05d.ppm", dump_dir, f);
+            if (!save_ppm(surface, path))
+                printf("Could not write %s\n", path);
+        }
+    }
+
+    print_frame_stats(&timer, show_stages);
+
+    frame_timer_free(&timer);
+    digit_atlas_free(&board.digits);
+    TTF_CloseFont(font);
+    TTF_Quit();
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    return 0;
+}
+
+
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--text-bench") == 0) {
+        int frames = (argc > 2) ? atoi(argv[2]) : 10000;
+        return run_text_benchmark(frames > 0 ? frames : 10000);
+    }
+
+    if (argc > 2 && strcmp(argv[1], "--selfplay") == 0) {
+        int threads = SDL_GetCPUCount();
+        const char *left = "predict";
+        const char *right = "noisy";
+        float dt = 1.0f;
+        int points = MATCH_POINTS;
+        Uint32 seed = 1;
+
+        for (int i = 3; i + 1 < argc; i += 2) {
+            if (strcmp(argv[i], "--threads") == 0) threads = atoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--left") == 0) left = argv[i + 1];
+            else if (strcmp(argv[i], "--right") == 0) right = argv[i + 1];
+            else if (strcmp(argv[i], "--dt") == 0) dt = (float)atof(argv[i + 1]);
+            else if (strcmp(argv[i], "--points") == 0) points = atoi(argv[i + 1]);
+            else if (strcmp(argv[i], "--seed") == 0)
+                seed = (Uint32)strtoul(argv[i + 1], NULL, 10);
+        }
+
+        if (!(dt >= MIN_DT) || isinf(dt)) {
+            printf("--dt must be a number of steps of at least %g\n", MIN_DT);
+            return 1;
+        }
+
+        int matches = atoi(argv[2]);
+        return run_selfplay(matches > 0 ? matches : 1, threads, left, right,
+                            dt, points > 0 ? points : 1, seed);
+    }
+
+    if (argc > 2 && strcmp(argv[1], "--headless") == 0) {
+        int show_stages = 0;
+        const char *dump_dir = NULL;
+
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--stages") == 0)
+                show_stages = 1;
+            else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+                dump_dir = argv[++i];
+        }
+
+        int frames = atoi(argv[2]);
+        return run_headless(frames > 0 ? frames : 1, show_stages, dump_dir);
+    }
+
     SDL_Init(SDL_INIT_VIDEO);
     TTF_Init();
 
@@ -141,6 +986,11 @@ int main(int argc, char *argv[])
         SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
     );
 
+    // without vsync the loop would spin; a 1 ms nap per frame is enough
+    SDL_RendererInfo info;
+    int vsync = SDL_GetRendererInfo(renderer, &info) == 0 &&
+                (info.flags & SDL_RENDERER_PRESENTVSYNC);
+
     TTF_Font *font = TTF_OpenFont("arial.ttf", 32);
     if (!font) {
     printf("FONT LOAD FAILED: %s\n", TTF_GetError());
@@ -153,29 +1003,25 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    SDL_Rect p1 = { 40, (WINDOW_HEIGHT - PADDLE_HEIGHT)/2,
-                    PADDLE_WIDTH, PADDLE_HEIGHT };
-
-    SDL_Rect p2 = { WINDOW_WIDTH - 40 - PADDLE_WIDTH,
-                    (WINDOW_HEIGHT - PADDLE_HEIGHT)/2,
-                    PADDLE_WIDTH, PADDLE_HEIGHT };
-
-    SDL_Rect ball = {
-        (WINDOW_WIDTH - BALL_SIZE)/2,
-        (WINDOW_HEIGHT - BALL_SIZE)/2,
-        BALL_SIZE, BALL_SIZE
-    };
-
-    float ball_vx = BALL_SPEED;
-    float ball_vy = 0.0f;
+    Scoreboard board;
+    if (!scoreboard_init(&board, renderer, font)) {
+        printf("Score atlas failed: %s\n", SDL_GetError());
+        return 1;
+    }
 
-    int score1 = 0;
-    int score2 = 0;
+    Match m;
+    match_init(&m, SDL_GetTicks());
 
-    GameState state = GAME_WAIT;
     int running = 1;
     SDL_Event event;
 
+    // the state before the last step, drawn blended with the current one
+    Paddle prev_p1 = m.p1, prev_p2 = m.p2;
+    Ball prev_ball = m.ball;
+
+    FixedClock clock;
+    fixed_clock_init(&clock, SIM_HZ);
+
     while (running) {
 
         while (SDL_PollEvent(&event)) {
@@ -188,44 +1034,52 @@ int main(int argc, char *argv[])
                     running = 0;
 
                 if (event.key.keysym.sym == SDLK_SPACE) {
-                    if (state == GAME_WAIT) state = GAME_PLAY;
-                    else if (state == GAME_PLAY) state = GAME_PAUSE;
-                    else state = GAME_PLAY;
+                    if (m.state == GAME_WAIT) m.state = GAME_PLAY;
+                    else if (m.state == GAME_PLAY) m.state = GAME_PAUSE;
+                    else m.state = GAME_PLAY;
                 }
 
                 if (event.key.keysym.sym == SDLK_x) {
-                    score1 = score2 = 0;
-                    reset_ball(&ball, &ball_vx, &ball_vy, 1);
-                    state = GAME_WAIT;
+                    m.score1 = m.score2 = 0;
+                    reset_ball(&m.ball, 1);
+                    prev_ball = m.ball;
+                    m.state = GAME_WAIT;
                 }
             }
         }
 
-        const Uint8 *keys = SDL_GetKeyboardState(NULL);
+        int steps = fixed_clock_begin(&clock);
 
-        if (keys[SDL_SCANCODE_W]) move_paddle(&p1, -PADDLE_SPEED);
-        if (keys[SDL_SCANCODE_S]) move_paddle(&p1,  PADDLE_SPEED);
-        if (keys[SDL_SCANCODE_UP]) move_paddle(&p2, -PADDLE_SPEED);
-        if (keys[SDL_SCANCODE_DOWN]) move_paddle(&p2,  PADDLE_SPEED);
+        for (int s = 0; s < steps; s++) {
+            prev_p1 = m.p1;
+            prev_p2 = m.p2;
+            prev_ball = m.ball;
 
-        if (state == GAME_PLAY)
-            move_ball(&ball, &ball_vx, &ball_vy,
-                      &p1, &p2, &score1, &score2, &state);
+            match_step(&m, keyboard_policy, keyboard_policy, 1.0f);
 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
+            // a point was scored and the ball jumped back to the
+            // middle; don't draw it sliding across the court
+            if (m.state == GAME_WAIT)
+                prev_ball = m.ball;
+        }
+        fixed_clock_sim_done(&clock);
 
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-        SDL_RenderFillRect(renderer, &p1);
-        SDL_RenderFillRect(renderer, &p2);
-        SDL_RenderFillRect(renderer, &ball);
+        float alpha = (float)fixed_clock_alpha(&clock);
+        SDL_Rect draw_p1 = lerp_paddle(&prev_p1, &m.p1, alpha);
+        SDL_Rect draw_p2 = lerp_paddle(&prev_p2, &m.p2, alpha);
+        SDL_Rect draw_ball = lerp_ball(&prev_ball, &m.ball, alpha);
 
-        draw_text(renderer, font, score1, WINDOW_WIDTH / 4, 20);
-        draw_text(renderer, font, score2, WINDOW_WIDTH * 3 / 4, 20);
+        draw_scene(renderer, &board, &draw_p1, &draw_p2, &draw_ball,
+                   m.score1, m.score2);
 
         SDL_RenderPresent(renderer);
+        fixed_clock_end(&clock);
+
+        if (!vsync)
+            SDL_Delay(1);
     }
 
+    digit_atlas_free(&board.digits);
     TTF_CloseFont(font);
     TTF_Quit();
     SDL_DestroyRenderer(renderer);
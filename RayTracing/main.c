@@ -1,10 +1,28 @@
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "../common/frame_stats.h"
 
 #define WIDTH  1000
 #define HEIGHT 800
 
+#define RAY_COUNT   720
+#define MAX_LEN     900.0
+#define RAY_BATCH   4
+#define EARTH_MARGIN 2.0    // covers pixel truncation plus float error
+#define MAX_THREADS 64
+
+#define MAX_OCCLUDERS 8
+#define MAX_POLY      (4 + 12 * MAX_OCCLUDERS)
+#define TANGENT_EPS   1e-4
+#define SOFT_SAMPLES  8
+
 #define COLOR_EARTH (SDL_Color){0, 0, 255, 255}
 #define COLOR_SUN   (SDL_Color){255, 200, 50, 255}
 #define COLOR_RAY   (SDL_Color){255, 180, 80, 255}
@@ -15,6 +33,60 @@ typedef struct Circle {
     double radius;
 } Circle;
 
+typedef struct Vec2 {
+    double x;
+    double y;
+} Vec2;
+
+typedef enum LightMode {
+    LIGHT_RAYS,     // ray marching, cost follows ray_count
+    LIGHT_POLYGON,  // exact visibility polygon, hard shadows
+    LIGHT_SOFT,     // several polygons across the sun's disc
+    LIGHT_MODE_COUNT
+} LightMode;
+
+typedef struct RayTable {
+    int count;      // rays actually cast
+    int padded;     // count rounded up to RAY_BATCH
+    double *dx;     // marching directions
+    double *dy;
+    float *fdx;     // same directions for the SIMD hit test
+    float *fdy;
+    int *stop;      // per frame: steps each ray takes before the earth
+} RayTable;
+
+/* A frame is drawn in two passes over the pool: first every thread finds
+ * where its share of the rays stops at the earth, then every thread
+ * marches all rays through its own band of rows. */
+enum { RAY_PASS_STOPS, RAY_PASS_DRAW };
+
+typedef struct RayJob {
+    Uint32 *pixels;
+    int pitch;
+    int w, h;
+    int pass;
+    int r0, r1;     // rays this job finds the stops of
+    int x0, x1;     // columns this job may write
+    int y0, y1;     // band of rows this job may write
+    Uint32 color;
+    Circle sun;
+    Circle earth;
+    const RayTable *table;
+} RayJob;
+
+typedef struct RayWorker {
+    SDL_Thread *thread;
+    SDL_sem *start;
+    SDL_sem *done;
+    RayJob job;
+    int quit;
+} RayWorker;
+
+typedef struct RayPool {
+    int threads;
+    RayWorker workers[MAX_THREADS];
+} RayPool;
+
 
 double dist(double x1, double y1, double x2, double y2) {
     double dx = x1 - x2;
@@ -22,15 +94,24 @@ double dist(double x1, double y1, double x2, double y2) {
     return sqrt(dx * dx + dy * dy);
 }
 
-void FillCircle(SDL_Surface *surface, Circle c, SDL_Color color) {
+/* Only the circle's bounding box inside clip is scanned. */
+void FillCircle(SDL_Surface *surface, Circle c, SDL_Color color,
+                const SDL_Rect *clip) {
     Uint32 col = SDL_MapRGB(surface->format, color.r, color.g, color.b);
 
+    SDL_Rect box = {
+        (int)floor(c.x - c.radius), (int)floor(c.y - c.radius),
+        (int)ceil(2 * c.radius) + 2, (int)ceil(2 * c.radius) + 2
+    };
+    if (!SDL_IntersectRect(&box, clip, &box))
+        return;
+
     SDL_LockSurface(surface);
     Uint32 *pixels = (Uint32 *)surface->pixels;
     int pitch = surface->pitch / 4;
 
-    for (int y = 0; y < surface->h; y++) {
-        for (int x = 0; x < surface->w; x++) {
+    for (int y = box.y; y < box.y + box.h; y++) {
+        for (int x = box.x; x < box.x + box.w; x++) {
             if (dist(x, y, c.x, c.y) <= c.radius) {
                 pixels[y * pitch + x] = col;
             }
@@ -40,47 +121,1110 @@ void FillCircle(SDL_Surface *surface, Circle c, SDL_Color color) {
     SDL_UnlockSurface(surface);
 }
 
-void DrawSunRays(SDL_Surface *surface, Circle sun, Circle earth) {
+/* Ray directions are fixed for a given ray count, so the cos/sin pairs are
+ * computed once and padded to a multiple of RAY_BATCH for the SIMD loop. */
+void BuildRayTable(RayTable *table, int ray_count) {
+    int padded = (ray_count + RAY_BATCH - 1) / RAY_BATCH * RAY_BATCH;
+
+    table->count = ray_count;
+    table->padded = padded;
+    table->dx = malloc(sizeof(double) * padded);
+    table->dy = malloc(sizeof(double) * padded);
+    table->fdx = malloc(sizeof(float) * padded);
+    table->fdy = malloc(sizeof(float) * padded);
+    table->stop = malloc(sizeof(int) * padded);
+
+    for (int i = 0; i < padded; i++) {
+        double angle = (2.0 * M_PI * i) / ray_count;
+        table->dx[i] = (i < ray_count) ? cos(angle) : 0.0;
+        table->dy[i] = (i < ray_count) ? sin(angle) : 0.0;
+        table->fdx[i] = (float)table->dx[i];
+        table->fdy[i] = (float)table->dy[i];
+    }
+}
+
+void FreeRayTable(RayTable *table) {
+    free(table->dx);
+    free(table->dy);
+    free(table->fdx);
+    free(table->fdy);
+    free(table->stop);
+    table->dx = table->dy = NULL;
+    table->fdx = table->fdy = NULL;
+    table->stop = NULL;
+    table->count = table->padded = 0;
+}
+
+/* Distance along RAY_BATCH rays at which each one enters a circle of
+ * radius sqrt(r2) around the earth, or max_len if it misses. Solves
+ * |o + t*d|^2 = r2 with o = sun - earth, so only b = o.d changes from ray
+ * to ray; c = |o|^2 - r2 is shared by the whole batch. */
+static void RayHitBatch(const float *dx, const float *dy,
+                        float ox, float oy, float c, float max_len,
+                        float *t_near) {
+#ifdef __SSE2__
+    __m128 zero = _mm_setzero_ps();
+    __m128 b    = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ox), _mm_loadu_ps(dx)),
+                             _mm_mul_ps(_mm_set1_ps(oy), _mm_loadu_ps(dy)));
+    __m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), _mm_set1_ps(c));
+    __m128 root = _mm_sqrt_ps(_mm_max_ps(disc, zero));
+    __m128 t_in = _mm_sub_ps(_mm_sub_ps(zero, b), root);
+    __m128 t_out = _mm_sub_ps(root, b);
+    __m128 hit  = _mm_and_ps(_mm_cmpge_ps(disc, zero),
+                             _mm_cmpge_ps(t_out, zero));
+    __m128 res  = _mm_or_ps(_mm_and_ps(hit, _mm_max_ps(t_in, zero)),
+                            _mm_andnot_ps(hit, _mm_set1_ps(max_len)));
+    _mm_storeu_ps(t_near, _mm_min_ps(res, _mm_set1_ps(max_len)));
+#else
+    for (int k = 0; k < RAY_BATCH; k++) {
+        float b = ox * dx[k] + oy * dy[k];
+        float disc = b * b - c;
+        float root = sqrtf(disc > 0.0f ? disc : 0.0f);
+        float t_in = -b - root;
+        int hit = disc >= 0.0f && root - b >= 0.0f;
+        float t = hit ? (t_in > 0.0f ? t_in : 0.0f) : max_len;
+        t_near[k] = t < max_len ? t : max_len;
+    }
+#endif
+}
+
+/* Narrows the step range [*k0, *k1) to the steps where o + d*t lies in the
+ * slab of pixels [lo, hi). Pixel 0 also collects (-1, 0) because the cast
+ * truncates toward zero; the per-pixel test in TraceRay absorbs rounding. */
+static int ClipSteps(double o, double d, int lo, int hi, double t0,
+                     int *k0, int *k1) {
+    if (fabs(d) > 1e-9) {
+        double ta = ((lo == 0 ? -1 : lo) - o) / d;
+        double tb = (hi - o) / d;
+        if (ta > tb) { double tmp = ta; ta = tb; tb = tmp; }
+        if (ta < 0.0) ta = 0.0;
+        if (tb > MAX_LEN) tb = MAX_LEN;
+        int ka = (int)floor(ta - t0) - 1;
+        int kb = (int)ceil(tb - t0) + 1;
+        if (ka > *k0) *k0 = ka;
+        if (kb < *k1) *k1 = kb;
+        return 1;
+    }
+    return o >= lo - 1 && o < hi + 1;
+}
+
+/* Number of steps one ray takes before it stops at the earth, or 0 when
+ * it starts off screen. t_near says where the per-pixel earth test can
+ * start; before it no pixel the ray touches can lie inside the earth. */
+static int RayStop(const RayJob *job, double dx, double dy, double t_near) {
+    double sx = job->sun.x;
+    double sy = job->sun.y;
+    double t0 = job->sun.radius;
+    int k1 = (int)ceil(MAX_LEN - t0);
+
+    int fx = (int)(sx + dx * t0);
+    int fy = (int)(sy + dy * t0);
+    if (fx < 0 || fx >= job->w || fy < 0 || fy >= job->h)
+        return 0;
+
+    /* Find the step where the ray stops at the earth. The search is
+     * bounded by the widened circle's diameter, so it is a handful of
+     * dist() calls instead of one per step. */
+    if (t_near < MAX_LEN) {
+        int k = (int)floor(t_near - t0);
+        int k_last = (int)ceil(t_near - t0
+                               + 2.0 * (job->earth.radius + EARTH_MARGIN)) + 1;
+        if (k < 0) k = 0;
+
+        for (; k < k_last && k < k1; k++) {
+            double t = t0 + k;
+            int x = (int)(sx + dx * t);
+            int y = (int)(sy + dy * t);
+            if (dist(x, y, job->earth.x, job->earth.y) <= job->earth.radius) {
+                k1 = k;
+                break;
+            }
+        }
+    }
+
+    return k1;
+}
+
+/* Marches the first k1 steps of one ray, writing only the pixels inside
+ * the job's clip box. Rays that never cross the box cost only the clip. */
+static void TraceRay(const RayJob *job, double dx, double dy, int k1) {
+    double sx = job->sun.x;
+    double sy = job->sun.y;
+    double t0 = job->sun.radius;
+    int k0 = 0;
+
+    if (k1 <= 0 ||
+        !ClipSteps(sx, dx, job->x0, job->x1, t0, &k0, &k1) ||
+        !ClipSteps(sy, dy, job->y0, job->y1, t0, &k0, &k1))
+        return;
+
+    for (int k = k0; k < k1; k++) {
+        double t = t0 + k;
+        int x = (int)(sx + dx * t);
+        int y = (int)(sy + dy * t);
+
+        if (x < 0 || x >= job->w || y < 0 || y >= job->h)
+            break;
+        if (x < job->x0 || x >= job->x1 || y < job->y0 || y >= job->y1)
+            continue;
+
+        job->pixels[y * job->pitch + x] = job->color;
+    }
+}
+
+/* Finds the stops of rays [r0, r1), which start on a RAY_BATCH boundary. */
+static void FindRayStops(const RayJob *job) {
+    const RayTable *table = job->table;
+    float reach = (float)(job->earth.radius + EARTH_MARGIN);
+    float ox = (float)(job->sun.x - job->earth.x);
+    float oy = (float)(job->sun.y - job->earth.y);
+    float c  = ox * ox + oy * oy - reach * reach;
+    float t_near[RAY_BATCH];
+
+    for (int i = job->r0; i < job->r1; i += RAY_BATCH) {
+        RayHitBatch(table->fdx + i, table->fdy + i, ox, oy, c,
+                    (float)MAX_LEN, t_near);
+
+        int n = table->count - i < RAY_BATCH ? table->count - i : RAY_BATCH;
+        for (int k = 0; k < n; k++)
+            table->stop[i + k] = RayStop(job, table->dx[i + k],
+                                         table->dy[i + k], t_near[k]);
+    }
+}
+
+/* Casts every ray in the table into the job's band of rows. */
+static void CastRayBand(const RayJob *job) {
+    const RayTable *table = job->table;
+
+    for (int i = 0; i < table->count; i++)
+        TraceRay(job, table->dx[i], table->dy[i], table->stop[i]);
+}
+
+static void RunRayJob(const RayJob *job) {
+    if (job->pass == RAY_PASS_STOPS)
+        FindRayStops(job);
+    else
+        CastRayBand(job);
+}
+
+static int RayWorkerMain(void *data) {
+    RayWorker *worker = data;
+
+    for (;;) {
+        SDL_SemWait(worker->start);
+        if (worker->quit)
+            break;
+        RunRayJob(&worker->job);
+        SDL_SemPost(worker->done);
+    }
+    return 0;
+}
+
+/* The calling thread always casts one band itself, so a pool of N threads
+ * only spawns N - 1 workers. */
+void RayPoolInit(RayPool *pool, int threads) {
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    pool->threads = threads;
+    for (int i = 0; i < threads - 1; i++) {
+        RayWorker *worker = &pool->workers[i];
+        worker->quit = 0;
+        worker->start = SDL_CreateSemaphore(0);
+        worker->done = SDL_CreateSemaphore(0);
+        worker->thread = SDL_CreateThread(RayWorkerMain, "ray", worker);
+    }
+}
+
+void RayPoolDestroy(RayPool *pool) {
+    for (int i = 0; i < pool->threads - 1; i++) {
+        RayWorker *worker = &pool->workers[i];
+        worker->quit = 1;
+        SDL_SemPost(worker->start);
+        SDL_WaitThread(worker->thread, NULL);
+        SDL_DestroySemaphore(worker->start);
+        SDL_DestroySemaphore(worker->done);
+    }
+    pool->threads = 1;
+}
+
+/* Runs one pass with part i of the rays and of the clip rectangle's rows
+ * on thread i; the calling thread takes the last part. */
+static void RunRayPass(RayPool *pool, RayJob job, const SDL_Rect *clip,
+                       int pass) {
+    int parts = pool->threads;
+    int batches = job.table->padded / RAY_BATCH;
+
+    job.pass = pass;
+    for (int i = 0; i < parts; i++) {
+        job.r0 = batches * i / parts * RAY_BATCH;
+        job.r1 = batches * (i + 1) / parts * RAY_BATCH;
+        job.y0 = clip->y + clip->h * i / parts;
+        job.y1 = clip->y + clip->h * (i + 1) / parts;
+
+        if (i == parts - 1) {
+            RunRayJob(&job);
+        } else {
+            pool->workers[i].job = job;
+            SDL_SemPost(pool->workers[i].start);
+        }
+    }
+
+    for (int i = 0; i < parts - 1; i++)
+        SDL_SemWait(pool->workers[i].done);
+}
+
+/* The earth search is split by ray, so each ray is searched once. The
+ * drawing is split by band of rows, so no two threads ever write the
+ * same pixel. */
+void DrawSunRays(SDL_Surface *surface, Circle sun, Circle earth,
+                 const RayTable *table, RayPool *pool, const SDL_Rect *clip) {
 
     Uint32 rayCol = SDL_MapRGB(
         surface->format,
         COLOR_RAY.r, COLOR_RAY.g, COLOR_RAY.b
     );
 
+    SDL_LockSurface(surface);
+
+    RayJob job;
+    job.pixels = (Uint32 *)surface->pixels;
+    job.pitch = surface->pitch / 4;
+    job.w = surface->w;
+    job.h = surface->h;
+    job.color = rayCol;
+    job.sun = sun;
+    job.earth = earth;
+    job.table = table;
+    job.x0 = clip->x;
+    job.x1 = clip->x + clip->w;
+
+    RunRayPass(pool, job, clip, RAY_PASS_STOPS);
+    RunRayPass(pool, job, clip, RAY_PASS_DRAW);
+
+    SDL_UnlockSurface(surface);
+}
+
+/* Distance from (px, py) along (dx, dy) to the nearest occluder or to the
+ * screen edge, whichever comes first. */
+static double CastToNearest(double px, double py, double dx, double dy,
+                            int w, int h, const Circle *occluders, int count) {
+    double t = 1e30;
+
+    if (dx > 0.0) t = fmin(t, (w - px) / dx);
+    if (dx < 0.0) t = fmin(t, -px / dx);
+    if (dy > 0.0) t = fmin(t, (h - py) / dy);
+    if (dy < 0.0) t = fmin(t, -py / dy);
+
+    for (int i = 0; i < count; i++) {
+        double ox = px - occluders[i].x;
+        double oy = py - occluders[i].y;
+        double b = ox * dx + oy * dy;
+        double c = ox * ox + oy * oy - occluders[i].radius * occluders[i].radius;
+        double disc = b * b - c;
+
+        if (disc >= 0.0) {
+            double t_in = -b - sqrt(disc);
+            if (t_in >= 0.0 && t_in < t)
+                t = t_in;
+        }
+    }
+
+    return t;
+}
+
+static int CompareAngles(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+/* Exact region lit by a point light. The hit surface can only change at a
+ * screen corner or just either side of an occluder's tangent, so one ray
+ * per such angle is enough. Where two neighbouring vertices land on the
+ * same circle the polygon cuts a chord through it, which the occluder
+ * itself is drawn over afterwards. Returns the vertex count, or 0 when
+ * the light sits inside an occluder or off screen. */
+int BuildVisibilityPolygon(Vec2 light, int w, int h,
+                           const Circle *occluders, int count, Vec2 *poly) {
+    double angles[MAX_POLY];
+    int n = 0;
+
+    if (light.x < 0 || light.x > w || light.y < 0 || light.y > h)
+        return 0;
+    if (count > MAX_OCCLUDERS)
+        count = MAX_OCCLUDERS;
+
+    angles[n++] = atan2(0 - light.y, 0 - light.x);
+    angles[n++] = atan2(0 - light.y, w - light.x);
+    angles[n++] = atan2(h - light.y, 0 - light.x);
+    angles[n++] = atan2(h - light.y, w - light.x);
+
+    for (int i = 0; i < count; i++) {
+        double d = dist(light.x, light.y, occluders[i].x, occluders[i].y);
+        if (d <= occluders[i].radius)
+            return 0;
+
+        double base = atan2(occluders[i].y - light.y, occluders[i].x - light.x);
+        double half = asin(occluders[i].radius / d);
+
+        angles[n++] = base - half - TANGENT_EPS;
+        angles[n++] = base - half + TANGENT_EPS;
+        angles[n++] = base + half - TANGENT_EPS;
+        angles[n++] = base + half + TANGENT_EPS;
+
+        /* Where an occluder runs off the screen, the hit surface changes
+         * from the circle to the screen edge without a tangent. */
+        for (int e = 0; e < 4; e++) {
+            int vertical = e < 2;
+            double edge = (e == 0) ? 0 : (e == 1) ? w : (e == 2) ? 0 : h;
+            double off = edge - (vertical ? occluders[i].x : occluders[i].y);
+            double r2 = occluders[i].radius * occluders[i].radius - off * off;
+            if (r2 < 0.0)
+                continue;
+
+            for (int side = -1; side <= 1; side += 2) {
+                double along = (vertical ? occluders[i].y : occluders[i].x) +
+                               side * sqrt(r2);
+                if (along < 0 || along > (vertical ? h : w))
+                    continue;
+                double px = vertical ? edge : along;
+                double py = vertical ? along : edge;
+                angles[n++] = atan2(py - light.y, px - light.x);
+            }
+        }
+    }
+
+    /* An occluder towards -x puts its tangents past +-pi; wrapped back
+     * into one turn they sort into the order they sweep the screen in. */
+    for (int i = 4; i < n; i++)
+        angles[i] = remainder(angles[i], 2.0 * M_PI);
+
+    qsort(angles, n, sizeof(double), CompareAngles);
+
+    for (int i = 0; i < n; i++) {
+        double dx = cos(angles[i]);
+        double dy = sin(angles[i]);
+        double t = CastToNearest(light.x, light.y, dx, dy, w, h,
+                                 occluders, count);
+        poly[i].x = light.x + dx * t;
+        poly[i].y = light.y + dy * t;
+    }
+
+    return n;
+}
+
+/* Even-odd scanline fill, sampling each row at its pixel centre and
+ * handing every covered span [x0, x1) inside clip to span(). */
+void FillPolygon(const Vec2 *poly, int n, const SDL_Rect *clip,
+                 void (*span)(void *ctx, int y, int x0, int x1), void *ctx) {
+    double xs[MAX_POLY];
+
+    if (n < 3)
+        return;
+
+    double ymin = poly[0].y, ymax = poly[0].y;
+    for (int i = 1; i < n; i++) {
+        if (poly[i].y < ymin) ymin = poly[i].y;
+        if (poly[i].y > ymax) ymax = poly[i].y;
+    }
+
+    int y0 = (int)floor(ymin);
+    int y1 = (int)ceil(ymax);
+    if (y0 < clip->y) y0 = clip->y;
+    if (y1 > clip->y + clip->h) y1 = clip->y + clip->h;
+
+    for (int y = y0; y < y1; y++) {
+        double yc = y + 0.5;
+        int k = 0;
+
+        for (int i = 0; i < n; i++) {
+            Vec2 a = poly[i];
+            Vec2 b = poly[(i + 1) % n];
+            if ((a.y <= yc) != (b.y <= yc))
+                xs[k++] = a.x + (yc - a.y) * (b.x - a.x) / (b.y - a.y);
+        }
+
+        for (int i = 1; i < k; i++) {
+            double v = xs[i];
+            int j = i - 1;
+            while (j >= 0 && xs[j] > v) {
+                xs[j + 1] = xs[j];
+                j--;
+            }
+            xs[j + 1] = v;
+        }
+
+        for (int i = 0; i + 1 < k; i += 2) {
+            int x0 = (int)ceil(xs[i] - 0.5);
+            int x1 = (int)ceil(xs[i + 1] - 0.5);
+            if (x0 < clip->x) x0 = clip->x;
+            if (x1 > clip->x + clip->w) x1 = clip->x + clip->w;
+            if (x1 > x0)
+                span(ctx, y, x0, x1);
+        }
+    }
+}
+
+typedef struct SpanTarget {
+    Uint32 *pixels;
+    int pitch;
+    Uint32 color;
+    Uint8 *accum;
+    int accum_pitch;
+} SpanTarget;
+
+static void SpanWrite(void *ctx, int y, int x0, int x1) {
+    SpanTarget *target = ctx;
+    Uint32 *row = target->pixels + y * target->pitch;
+    for (int x = x0; x < x1; x++)
+        row[x] = target->color;
+}
+
+static void SpanAccumulate(void *ctx, int y, int x0, int x1) {
+    SpanTarget *target = ctx;
+    Uint8 *row = target->accum + y * target->accum_pitch;
+    for (int x = x0; x < x1; x++)
+        row[x]++;
+}
+
+/* Hard shadows: one visibility polygon from the centre of the sun. */
+void DrawLightPolygon(SDL_Surface *surface, Circle sun,
+                      const Circle *occluders, int count,
+                      const SDL_Rect *clip) {
+    Vec2 poly[MAX_POLY];
+    Vec2 light = { sun.x, sun.y };
+    int n = BuildVisibilityPolygon(light, surface->w, surface->h,
+                                   occluders, count, poly);
+
+    SDL_LockSurface(surface);
+
+    SpanTarget target;
+    target.pixels = (Uint32 *)surface->pixels;
+    target.pitch = surface->pitch / 4;
+    target.color = SDL_MapRGB(surface->format,
+                              COLOR_RAY.r, COLOR_RAY.g, COLOR_RAY.b);
+    FillPolygon(poly, n, clip, SpanWrite, &target);
+
+    SDL_UnlockSurface(surface);
+}
+
+/* Sample i of SOFT_SAMPLES points spread over the sun's disc on a
+ * golden-angle spiral. */
+Vec2 SoftSample(Circle sun, int i) {
+    double r = sun.radius * sqrt((i + 0.5) / SOFT_SAMPLES);
+    double a = i * 2.39996323;
+    Vec2 light = { sun.x + r * cos(a), sun.y + r * sin(a) };
+    return light;
+}
+
+/* Soft shadows: visibility polygons from the SoftSample points are
+ * counted per pixel, and the count sets the brightness. accum must hold
+ * surface->w * surface->h bytes and is left zeroed for the next frame. */
+void DrawLightSoft(SDL_Surface *surface, Circle sun,
+                   const Circle *occluders, int count, Uint8 *accum,
+                   const SDL_Rect *clip) {
+    Vec2 poly[MAX_POLY];
+    Uint32 shade[SOFT_SAMPLES + 1];
+
+    SpanTarget target;
+    target.accum = accum;
+    target.accum_pitch = surface->w;
+
+    for (int i = 0; i < SOFT_SAMPLES; i++) {
+        int n = BuildVisibilityPolygon(SoftSample(sun, i),
+                                       surface->w, surface->h,
+                                       occluders, count, poly);
+        FillPolygon(poly, n, clip, SpanAccumulate, &target);
+    }
+
+    for (int i = 0; i <= SOFT_SAMPLES; i++) {
+        shade[i] = SDL_MapRGB(surface->format,
+                              COLOR_RAY.r * i / SOFT_SAMPLES,
+                              COLOR_RAY.g * i / SOFT_SAMPLES,
+                              COLOR_RAY.b * i / SOFT_SAMPLES);
+    }
+
     SDL_LockSurface(surface);
     Uint32 *pixels = (Uint32 *)surface->pixels;
     int pitch = surface->pitch / 4;
 
-    int ray_count = 720;
-    double max_len = 900.0;
+    for (int y = clip->y; y < clip->y + clip->h; y++) {
+        Uint8 *row = accum + y * surface->w;
+        for (int x = clip->x; x < clip->x + clip->w; x++) {
+            if (row[x]) {
+                pixels[y * pitch + x] = shade[row[x]];
+                row[x] = 0;
+            }
+        }
+    }
 
-    for (int i = 0; i < ray_count; i++) {
-        double angle = (2.0 * M_PI * i) / ray_count;
-        double dx = cos(angle);
-        double dy = sin(angle);
+    SDL_UnlockSurface(surface);
+}
 
-        for (double t = sun.radius; t < max_len; t += 1.0) {
+/* Bounding box of everything an occluder can change when lit from light:
+ * the circle itself plus its shadow out to the screen edge. The radius is
+ * widened by EARTH_MARGIN so rays that stop on a grazing pixel are
+ * covered too. */
+SDL_Rect ShadowBounds(Vec2 light, Circle occ, int w, int h) {
+    SDL_Rect full = { 0, 0, w, h };
+    double r = occ.radius + EARTH_MARGIN;
+    double d = dist(light.x, light.y, occ.x, occ.y);
 
-            int x = (int)(sun.x + dx * t);
-            int y = (int)(sun.y + dy * t);
+    if (d <= r || light.x < 0 || light.x > w || light.y < 0 || light.y > h)
+        return full;
 
-            if (x < 0 || x >= surface->w ||
-                y < 0 || y >= surface->h)
-                break;
+    double x0 = occ.x - r, x1 = occ.x + r;
+    double y0 = occ.y - r, y1 = occ.y + r;
+    double base = atan2(occ.y - light.y, occ.x - light.x);
+    double half = asin(r / d);
 
-            
-            if (dist(x, y, earth.x, earth.y) <= earth.radius)
+    /* The shadow is bounded by the two tangent rays and whatever screen
+     * corners fall between them. */
+    for (int side = -1; side <= 1; side += 2) {
+        double dx = cos(base + side * half);
+        double dy = sin(base + side * half);
+        double t = CastToNearest(light.x, light.y, dx, dy, w, h, NULL, 0);
+        double px = light.x + dx * t;
+        double py = light.y + dy * t;
+        x0 = fmin(x0, px); x1 = fmax(x1, px);
+        y0 = fmin(y0, py); y1 = fmax(y1, py);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        double cx = (i & 1) ? w : 0;
+        double cy = (i & 2) ? h : 0;
+        double off = remainder(atan2(cy - light.y, cx - light.x) - base,
+                               2.0 * M_PI);
+        if (fabs(off) <= half) {
+            x0 = fmin(x0, cx); x1 = fmax(x1, cx);
+            y0 = fmin(y0, cy); y1 = fmax(y1, cy);
+        }
+    }
+
+    SDL_Rect box = {
+        (int)floor(x0) - 1, (int)floor(y0) - 1, 0, 0
+    };
+    box.w = (int)ceil(x1) + 2 - box.x;
+    box.h = (int)ceil(y1) + 2 - box.y;
+    SDL_IntersectRect(&box, &full, &box);
+    return box;
+}
+
+/* Area to redraw when only the earth moved: the old and new earth with
+ * their shadows, seen from every light position the mode uses. */
+SDL_Rect EarthDirtyRect(Circle sun, Circle old_earth, Circle new_earth,
+                        LightMode mode, int w, int h) {
+    Vec2 center = { sun.x, sun.y };
+    SDL_Rect dirty = ShadowBounds(center, old_earth, w, h);
+    SDL_Rect next = ShadowBounds(center, new_earth, w, h);
+    SDL_UnionRect(&dirty, &next, &dirty);
+
+    if (mode == LIGHT_SOFT) {
+        for (int i = 0; i < SOFT_SAMPLES; i++) {
+            Vec2 light = SoftSample(sun, i);
+            next = ShadowBounds(light, old_earth, w, h);
+            SDL_UnionRect(&dirty, &next, &dirty);
+            next = ShadowBounds(light, new_earth, w, h);
+            SDL_UnionRect(&dirty, &next, &dirty);
+        }
+    }
+
+    return dirty;
+}
+
+/* Redraws everything inside clip: background, lighting, then the sun and
+ * the earth on top. */
+void RenderScene(SDL_Surface *surface, Circle sun, Circle earth,
+                 LightMode mode, const RayTable *table, RayPool *pool,
+                 Uint8 *accum, const SDL_Rect *clip) {
+
+    SDL_FillRect(surface, clip, SDL_MapRGB(surface->format, 0, 0, 0));
+
+    if (mode == LIGHT_RAYS)
+        DrawSunRays(surface, sun, earth, table, pool, clip);
+    else if (mode == LIGHT_POLYGON)
+        DrawLightPolygon(surface, sun, &earth, 1, clip);
+    else
+        DrawLightSoft(surface, sun, &earth, 1, accum, clip);
+
+    FillCircle(surface, sun, COLOR_SUN, clip);
+    FillCircle(surface, earth, COLOR_EARTH, clip);
+}
+
+/* Headless benchmark: casts rays into an offscreen surface and reports
+ * rays per second for each ray count and thread count. */
+int RunBenchmark(int max_threads) {
+    static const int ray_counts[] = { 720, 10000, 100000, 1000000 };
+    int ray_count_n = sizeof(ray_counts) / sizeof(ray_counts[0]);
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_RGB888);
+    if (!surface) {
+        printf("Surface creation failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    Circle sun   = {500, 400, 140};
+    Circle earth = {750, 400, 80};
+    SDL_Rect full = { 0, 0, WIDTH, HEIGHT };
+    double freq = (double)SDL_GetPerformanceFrequency();
+
+    printf("%10s %8s %10s %14s\n", "rays", "threads", "ms/frame", "rays/s");
+
+    for (int r = 0; r < ray_count_n; r++) {
+        RayTable table;
+        BuildRayTable(&table, ray_counts[r]);
+
+        int next;
+        for (int threads = 1; threads <= max_threads; threads = next) {
+            RayPool pool;
+            RayPoolInit(&pool, threads);
+
+            int frames = 0;
+            Uint64 start = SDL_GetPerformanceCounter();
+            double elapsed = 0.0;
+
+            while (frames < 3 || elapsed < 0.5) {
+                SDL_FillRect(surface, NULL, 0);
+                DrawSunRays(surface, sun, earth, &table, &pool, &full);
+                frames++;
+                elapsed = (SDL_GetPerformanceCounter() - start) / freq;
+            }
+
+            printf("%10d %8d %10.3f %14.0f\n",
+                   ray_counts[r], threads,
+                   elapsed * 1000.0 / frames,
+                   (double)ray_counts[r] * frames / elapsed);
+
+            RayPoolDestroy(&pool);
+
+            next = threads * 2;
+            if (threads < max_threads && next > max_threads)
+                next = max_threads;
+        }
+
+        FreeRayTable(&table);
+    }
+
+    /* Ray marching against the exact lighting modes. Their cost follows
+     * the number of occluders and the lit area, not a ray count. */
+    Uint8 *accum = calloc(WIDTH * HEIGHT, 1);
+    static const char *modes[] = { "rays 720", "rays 100000",
+                                   "polygon", "soft" };
+
+    printf("\n%12s %8s %10s\n", "lighting", "threads", "ms/frame");
+
+    for (int m = 0; m < 4; m++) {
+        RayTable table;
+        RayPool pool;
+        BuildRayTable(&table, m == 1 ? 100000 : RAY_COUNT);
+        RayPoolInit(&pool, m < 2 ? max_threads : 1);
+
+        int frames = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        double elapsed = 0.0;
+
+        while (frames < 3 || elapsed < 0.5) {
+            SDL_FillRect(surface, NULL, 0);
+            if (m < 2)
+                DrawSunRays(surface, sun, earth, &table, &pool, &full);
+            else if (m == 2)
+                DrawLightPolygon(surface, sun, &earth, 1, &full);
+            else
+                DrawLightSoft(surface, sun, &earth, 1, accum, &full);
+            frames++;
+            elapsed = (SDL_GetPerformanceCounter() - start) / freq;
+        }
+
+        printf("%12s %8d %10.3f\n", modes[m], pool.threads,
+               elapsed * 1000.0 / frames);
+
+        RayPoolDestroy(&pool);
+        FreeRayTable(&table);
+    }
+
+    /* Dragging the earth: a full redraw against only the dirty area. */
+    RayTable table;
+    RayPool pool;
+    BuildRayTable(&table, RAY_COUNT);
+    RayPoolInit(&pool, max_threads);
+
+    printf("\n%12s %12s %12s %8s\n",
+           "lighting", "full ms", "dirty ms", "area %");
+
+    for (int m = 0; m < LIGHT_MODE_COUNT; m++) {
+        double ms[2];
+        double area = 0.0;
+
+        for (int dirty_only = 0; dirty_only < 2; dirty_only++) {
+            Circle moving = earth;
+            int frames = 0;
+            Uint64 start = SDL_GetPerformanceCounter();
+            double elapsed = 0.0;
+
+            area = 0.0;
+            RenderScene(surface, sun, moving, m, &table, &pool, accum, &full);
+
+            while (frames < 3 || elapsed < 0.5) {
+                Circle next = moving;
+                next.y = 300 + (frames * 5) % 200;
+
+                SDL_Rect clip = dirty_only
+                    ? EarthDirtyRect(sun, moving, next, m, WIDTH, HEIGHT)
+                    : full;
+                RenderScene(surface, sun, next, m, &table, &pool, accum, &clip);
+                area += (double)clip.w * clip.h / (WIDTH * HEIGHT);
+
+                moving = next;
+                frames++;
+                elapsed = (SDL_GetPerformanceCounter() - start) / freq;
+            }
+
+            ms[dirty_only] = elapsed * 1000.0 / frames;
+            area /= frames;
+        }
+
+        printf("%12s %12.3f %12.3f %8.1f\n", modes[m == 0 ? 0 : m + 1],
+               ms[0], ms[1], area * 100.0);
+    }
+
+    RayPoolDestroy(&pool);
+    FreeRayTable(&table);
+    free(accum);
+    SDL_FreeSurface(surface);
+    return 0;
+}
+
+/* Renders frame_count frames offscreen as fast as possible while the
+ * earth orbits the sun, and reports frame times. The present stage copies
+ * each frame into a second surface standing in for the window's, which is
+ * the copy SDL_UpdateWindowSurfaceRects makes for a full-screen rect. */
+int RunHeadless(int frame_count, int show_stages, const char *dump_dir,
+                LightMode mode, int ray_count) {
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_RGB888);
+    SDL_Surface *screen = SDL_CreateRGBSurfaceWithFormat(
+        0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_RGB888);
+    if (!surface || !screen) {
+        printf("Surface creation failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    Circle sun   = {500, 400, 140};
+    Circle earth = {750, 400, 80};
+    SDL_Rect full = { 0, 0, WIDTH, HEIGHT };
+
+    RayTable table;
+    BuildRayTable(&table, ray_count);
+    RayPool pool;
+    RayPoolInit(&pool, SDL_GetCPUCount());
+    Uint8 *accum = calloc(WIDTH * HEIGHT, 1);
+
+    FrameTimer timer;
+    frame_timer_init(&timer, frame_count);
+
+    for (int f = 0; f < frame_count; f++) {
+        frame_timer_skip(&timer);
+
+        double a = f * 0.02;
+        earth.x = sun.x + 250.0 * cos(a);
+        earth.y = sun.y + 200.0 * sin(a);
+        frame_timer_stage(&timer, STAGE_UPDATE);
+
+        RenderScene(surface, sun, earth, mode, &table, &pool, accum, &full);
+        frame_timer_stage(&timer, STAGE_RASTER);
+
+        SDL_BlitSurface(surface, &full, screen, NULL);
+        frame_timer_stage(&timer, STAGE_PRESENT);
+
+        timer.frames++;
+
+        if (dump_dir) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/frame_%05d.ppm", dump_dir, f);
+            if (!save_ppm(surface, path))
+                printf("Could not write %s\n", path);
+        }
+    }
+
+    print_frame_stats(&timer, show_stages);
+
+    frame_timer_free(&timer);
+    free(accum);
+    RayPoolDestroy(&pool);
+    FreeRayTable(&table);
+    SDL_FreeSurface(screen);
+    SDL_FreeSurface(surface);
+    return 0;
+}
+
+/* Pixels lit by a point light, the slow way: pixel (x, y) is lit when
+ * nothing blocks the segment from the light to its centre. */
+static int LitDirect(Vec2 light, double x, double y,
+                     const Circle *occluders, int count) {
+    double d = dist(light.x, light.y, x, y);
+    if (d == 0.0)
+        return 1;
+    double t = CastToNearest(light.x, light.y, (x - light.x) / d,
+                             (y - light.y) / d, WIDTH, HEIGHT,
+                             occluders, count);
+    return t >= d;
+}
+
+static void SpanMark(void *ctx, int y, int x0, int x1) {
+    Uint8 *lit = ctx;
+    for (int x = x0; x < x1; x++)
+        lit[y * WIDTH + x] = 1;
+}
+
+/* Fills the visibility polygon of one light and compares it with
+ * LitDirect at every pixel centre. Pixels inside an occluder are skipped
+ * (the polygon may cut a chord through it, and the occluder is drawn on
+ * top), and so are pixels next to a shadow edge, where the two tests can
+ * round a grazing centre either way. Returns the wrong pixels. */
+static int CheckPolygon(Vec2 light, const Circle *occluders, int count,
+                        Uint8 *lit, Uint8 *direct) {
+    Vec2 poly[MAX_POLY];
+    SDL_Rect full = { 0, 0, WIDTH, HEIGHT };
+    int wrong = 0;
+
+    memset(lit, 0, WIDTH * HEIGHT);
+    int n = BuildVisibilityPolygon(light, WIDTH, HEIGHT, occluders, count, poly);
+    FillPolygon(poly, n, &full, SpanMark, lit);
+
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            direct[y * WIDTH + x] = (Uint8)LitDirect(light, x + 0.5, y + 0.5,
+                                                     occluders, count);
+
+    for (int y = 1; y < HEIGHT - 1; y++) {
+        for (int x = 1; x < WIDTH - 1; x++) {
+            int inside = 0, edge = 0;
+            Uint8 v = direct[y * WIDTH + x];
+
+            for (int i = 0; i < count; i++)
+                if (dist(x + 0.5, y + 0.5, occluders[i].x, occluders[i].y) <=
+                    occluders[i].radius + EARTH_MARGIN)
+                    inside = 1;
+            for (int dy = -1; dy <= 1; dy++)
+                for (int dx = -1; dx <= 1; dx++)
+                    if (direct[(y + dy) * WIDTH + x + dx] != v)
+                        edge = 1;
+
+            if (!inside && !edge && lit[y * WIDTH + x] != v)
+                wrong++;
+        }
+    }
+    return wrong;
+}
+
+/* Redraws a random walk of earth positions two ways, inside
+ * EarthDirtyRect only and in full, and counts the frames where the two
+ * surfaces differ anywhere. */
+static int CheckDirtyRects(LightMode mode, SDL_Surface *dirty_surface,
+                           SDL_Surface *full_surface, Uint8 *accum,
+                           const RayTable *table, RayPool *pool) {
+    Circle sun = {500, 400, 140};
+    Circle earth = {750, 400, 80};
+    SDL_Rect full = { 0, 0, WIDTH, HEIGHT };
+    Uint32 seed = 7;
+    int bad = 0;
+
+    RenderScene(dirty_surface, sun, earth, mode, table, pool, accum, &full);
+
+    for (int f = 0; f < 300; f++) {
+        Circle next = earth;
+        do {
+            seed = seed * 1103515245u + 12345u;
+            next.x = (seed >> 8) % WIDTH;
+            seed = seed * 1103515245u + 12345u;
+            next.y = (seed >> 8) % HEIGHT;
+        } while (dist(next.x, next.y, sun.x, sun.y) <= next.radius + 2);
+
+        SDL_Rect clip = EarthDirtyRect(sun, earth, next, mode, WIDTH, HEIGHT);
+        RenderScene(dirty_surface, sun, next, mode, table, pool, accum, &clip);
+        RenderScene(full_surface, sun, next, mode, table, pool, accum, &full);
+        earth = next;
+
+        for (int y = 0; y < HEIGHT; y++) {
+            if (memcmp((Uint8 *)dirty_surface->pixels + y * dirty_surface->pitch,
+                       (Uint8 *)full_surface->pixels + y * full_surface->pitch,
+                       WIDTH * 4) != 0) {
+                bad++;
+                /* start the next frame from the correct picture */
+                RenderScene(dirty_surface, sun, earth, mode, table, pool,
+                            accum, &full);
                 break;
+            }
+        }
+    }
+    return bad;
+}
+
+/* --check: the exact lighting modes against LitDirect, for the sun and
+ * every soft-shadow sample with the earth on all sides, then for random
+ * scenes, and the dirty-rectangle redraw against a full one. An earth
+ * left of the light puts its tangents across -x, where the polygon
+ * angles wrap; with the light near the left edge a screen corner falls
+ * between the wrapped tangents too. */
+int RunCheck(void) {
+    Uint8 *lit = malloc(WIDTH * HEIGHT);
+    Uint8 *direct = malloc(WIDTH * HEIGHT);
+    if (!lit || !direct) {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    Circle sun = {500, 400, 140};
+    Circle earths[] = {
+        {750, 400, 80}, {250, 400, 80}, {250, 395, 80}, {250, 405, 80},
+        {500, 150, 80}, {500, 650, 80}, {300, 250, 60}, {320, 560, 70},
+        {40, 400, 30},
+    };
+    int failures = 0;
+
+    for (size_t e = 0; e < sizeof(earths) / sizeof(earths[0]); e++) {
+        for (int i = -1; i < SOFT_SAMPLES; i++) {
+            Vec2 light = { sun.x, sun.y };
+            if (i >= 0)
+                light = SoftSample(sun, i);
 
-            pixels[y * pitch + x] = rayCol;
+            int wrong = CheckPolygon(light, &earths[e], 1, lit, direct);
+            if (wrong) {
+                printf("light (%.1f, %.1f), earth (%.0f, %.0f): "
+                       "%d wrong pixels\n", light.x, light.y,
+                       earths[e].x, earths[e].y, wrong);
+                failures++;
+            }
         }
     }
 
-    SDL_UnlockSurface(surface);
+    struct { Vec2 light; Circle earth; } cases[] = {
+        { {200, 30}, {100, 40, 30} },
+        { {200, 770}, {100, 760, 30} },
+        { {120, 20}, {60, 12, 20} },
+        { {150, 400}, {60, 400, 50} },
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        int wrong = CheckPolygon(cases[c].light, &cases[c].earth, 1, lit, direct);
+        if (wrong) {
+            printf("case %d: %d wrong pixels\n", (int)c, wrong);
+            failures++;
+        }
+    }
+
+    Uint32 seed = 1;
+    for (int r = 0; r < 40; r++) {
+        double v[5];
+        for (int k = 0; k < 5; k++) {
+            seed = seed * 1103515245u + 12345u;
+            v[k] = (seed >> 8) / 16777216.0;
+        }
+        Vec2 light = { v[0] * WIDTH, v[1] * HEIGHT };
+        Circle earth = { v[2] * WIDTH, v[3] * HEIGHT, 20 + v[4] * 100 };
+        if (dist(light.x, light.y, earth.x, earth.y) <= earth.radius + 2)
+            continue;
+
+        int wrong = CheckPolygon(light, &earth, 1, lit, direct);
+        if (wrong) {
+            printf("random light (%.1f, %.1f), earth (%.1f, %.1f, %.1f): "
+                   "%d wrong pixels\n", light.x, light.y,
+                   earth.x, earth.y, earth.radius, wrong);
+            failures++;
+        }
+    }
+
+    /* two occluders, one on each side */
+    Circle pair[] = { {250, 400, 80}, {750, 400, 80} };
+    Vec2 light = { sun.x, sun.y };
+    int wrong = CheckPolygon(light, pair, 2, lit, direct);
+    if (wrong) {
+        printf("two occluders: %d wrong pixels\n", wrong);
+        failures++;
+    }
+
+    printf("visibility polygon: %s\n", failures ? "FAILED" : "ok");
+    free(direct);
+    free(lit);
+
+    SDL_Surface *dirty_surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_RGB888);
+    SDL_Surface *full_surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_RGB888);
+    Uint8 *accum = calloc(WIDTH * HEIGHT, 1);
+    if (!dirty_surface || !full_surface || !accum) {
+        printf("Surface creation failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    RayTable table;
+    RayPool pool;
+    BuildRayTable(&table, RAY_COUNT);
+    RayPoolInit(&pool, 1);
+
+    static const char *mode_names[] = { "rays", "polygon", "soft" };
+    int dirty_failures = 0;
+    for (int m = 0; m < LIGHT_MODE_COUNT; m++) {
+        int bad = CheckDirtyRects(m, dirty_surface, full_surface, accum,
+                                  &table, &pool);
+        printf("dirty rects, %s: %s", mode_names[m], bad ? "FAILED" : "ok");
+        if (bad)
+            printf(" (%d of 300 frames differ from a full redraw)", bad);
+        printf("\n");
+        dirty_failures += bad;
+    }
+
+    RayPoolDestroy(&pool);
+    FreeRayTable(&table);
+    free(accum);
+    SDL_FreeSurface(full_surface);
+    SDL_FreeSurface(dirty_surface);
+    return (failures || dirty_failures) ? 1 : 0;
 }
 
 int main(int argc, char *argv[]) {
 
+    if (argc > 1 && strcmp(argv[1], "--check") == 0)
+        return RunCheck();
+
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        int max_threads = (argc > 2) ? atoi(argv[2]) : SDL_GetCPUCount();
+        return RunBenchmark(max_threads > 0 ? max_threads : 1);
+    }
+
+    if (argc > 2 && strcmp(argv[1], "--headless") == 0) {
+        int show_stages = 0;
+        const char *dump_dir = NULL;
+        LightMode mode = LIGHT_RAYS;
+        int ray_count = RAY_COUNT;
+
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--stages") == 0)
+                show_stages = 1;
+            else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+                dump_dir = argv[++i];
+            else if (strcmp(argv[i], "--light") == 0 && i + 1 < argc) {
+                int v = atoi(argv[++i]);
+                if (v < 0 || v >= LIGHT_MODE_COUNT) {
+                    printf("--light must be 0 (rays), 1 (polygon) or 2 (soft)\n");
+                    return 1;
+                }
+                mode = (LightMode)v;
+            }
+            else if (strcmp(argv[i], "--rays") == 0 && i + 1 < argc)
+                ray_count = atoi(argv[++i]);
+        }
+
+        int frames = atoi(argv[2]);
+        return RunHeadless(frames > 0 ? frames : 1, show_stages, dump_dir,
+                           mode, ray_count > 0 ? ray_count : RAY_COUNT);
+    }
+
+    int ray_count = (argc > 1) ? atoi(argv[1]) : RAY_COUNT;
+    if (ray_count <= 0)
+        ray_count = RAY_COUNT;
+
     SDL_Init(SDL_INIT_VIDEO);
 
     SDL_Window *window = SDL_CreateWindow(
@@ -96,10 +1240,27 @@ int main(int argc, char *argv[]) {
     Circle sun   = {500, 400, 140};
     Circle earth = {750, 400, 80};
 
+    RayTable table;
+    BuildRayTable(&table, ray_count);
+
+    RayPool pool;
+    RayPoolInit(&pool, SDL_GetCPUCount());
+
+    LightMode mode = LIGHT_RAYS;
+    static const char *mode_names[] = { "rays", "polygon", "soft" };
+    Uint8 *accum = calloc(surface->w * surface->h, 1);
+
     int running = 1;
     int dragging_sun = 0;
     int dragging_earth = 0;
 
+    /* What the window currently shows, so a frame only redraws the area
+     * that actually changed. */
+    int full_redraw = 1;
+    Circle shown_earth = earth;
+    Circle shown_sun = sun;
+    LightMode shown_mode = mode;
+
     SDL_Event event;
 
     while (running) {
@@ -108,10 +1269,20 @@ int main(int argc, char *argv[]) {
             if (event.type == SDL_QUIT)
                 running = 0;
 
+            if (event.type == SDL_WINDOWEVENT &&
+                event.window.event == SDL_WINDOWEVENT_EXPOSED)
+                full_redraw = 1;
+
             if (event.type == SDL_KEYDOWN &&
                 event.key.keysym.sym == SDLK_ESCAPE)
                 running = 0;
 
+            if (event.type == SDL_KEYDOWN &&
+                event.key.keysym.sym == SDLK_l) {
+                mode = (mode + 1) % LIGHT_MODE_COUNT;
+                printf("Lighting: %s\n", mode_names[mode]);
+            }
+
             
             if (event.type == SDL_MOUSEBUTTONDOWN &&
                 event.button.button == SDL_BUTTON_LEFT) {
@@ -147,17 +1318,39 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        SDL_FillRect(surface, NULL,
-            SDL_MapRGB(surface->format, 0, 0, 0));
+        if (!running)
+            break;
 
-        DrawSunRays(surface, sun, earth);
-        FillCircle(surface, sun, COLOR_SUN);
-        FillCircle(surface, earth, COLOR_EARTH);
+        int sun_moved = sun.x != shown_sun.x || sun.y != shown_sun.y;
+        int earth_moved = earth.x != shown_earth.x || earth.y != shown_earth.y;
+
+        /* Nothing changed: sleep until the next event instead of
+         * redrawing an identical frame. */
+        if (!full_redraw && !sun_moved && !earth_moved && mode == shown_mode) {
+            SDL_WaitEvent(NULL);
+            continue;
+        }
+
+        SDL_Rect dirty = { 0, 0, surface->w, surface->h };
+        if (!full_redraw && !sun_moved && mode == shown_mode)
+            dirty = EarthDirtyRect(sun, shown_earth, earth, mode,
+                                   surface->w, surface->h);
+
+        RenderScene(surface, sun, earth, mode, &table, &pool, accum, &dirty);
+        SDL_UpdateWindowSurfaceRects(window, &dirty, 1);
+
+        shown_sun = sun;
+        shown_earth = earth;
+        shown_mode = mode;
+        full_redraw = 0;
 
-        SDL_UpdateWindowSurface(window);
         SDL_Delay(16);
     }
 
+    free(accum);
+    RayPoolDestroy(&pool);
+    FreeRayTable(&table);
+
     SDL_DestroyWindow(window);
     SDL_Quit();
     return 0;
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "harness.h"
+
+// CoustomCalMal against the C library's malloc on the same request
+// streams. Every pattern is a fixed list of sizes drawn once, so both
+// allocators see exactly the same requests in the same order.
+
+#define BLOCKS      1000
+#define MIN_SIZE    16
+#define MAX_SIZE    512
+#define CHURN_OPS   20000
+#define REALLOC_TOP (1 << 20)
+#define BENCH_ARENA (64u * 1024 * 1024)
+
+typedef struct {
+    void *(*alloc)(size_t);
+    void *(*resize)(void *, size_t);
+    void (*release)(void *);
+    int custom;         // start every run from a fresh arena
+} Allocator;
+
+typedef struct {
+    const Allocator *allocator;
+    void *ptrs[BLOCKS];
+} Job;
+
+static size_t sizes[BLOCKS];
+static unsigned churn_slot[CHURN_OPS];
+static size_t churn_size[CHURN_OPS];
+
+static const Allocator custom = { my_malloc, my_realloc, my_free, 1 };
+static const Allocator libc = { malloc, realloc, free, 0 };
+
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ull;
+
+static unsigned next_random(void) {
+    // xorshift64*, enough to spread the sizes
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (unsigned)((rng_state * 2685821657736338717ull) >> 32);
+}
+
+static void make_patterns(void) {
+    for (int i = 0; i < BLOCKS; i++)
+        sizes[i] = MIN_SIZE + next_random() % (MAX_SIZE - MIN_SIZE + 1);
+    for (int i = 0; i < CHURN_OPS; i++) {
+        churn_slot[i] = next_random() % BLOCKS;
+        churn_size[i] = MIN_SIZE + next_random() % (MAX_SIZE - MIN_SIZE + 1);
+    }
+}
+
+static void fresh_arena(void *arg) {
+    Job *job = arg;
+    if (job->allocator->custom)
+        allocator_init(BENCH_ARENA);
+    memset(job->ptrs, 0, sizeof(job->ptrs));
+}
+
+static void alloc_all(Job *job) {
+    for (int i = 0; i < BLOCKS; i++) {
+        job->ptrs[i] = job->allocator->alloc(sizes[i]);
+        if (!job->ptrs[i]) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        // touch it, as a real caller would
+        *(char *)job->ptrs[i] = (char)i;
+    }
+}
+
+// freed in the order they were allocated
+static void run_fifo(void *arg) {
+    Job *job = arg;
+    alloc_all(job);
+    for (int i = 0; i < BLOCKS; i++)
+        job->allocator->release(job->ptrs[i]);
+}
+
+// freed newest first, like a stack
+static void run_lifo(void *arg) {
+    Job *job = arg;
+    alloc_all(job);
+    for (int i = BLOCKS - 1; i >= 0; i--)
+        job->allocator->release(job->ptrs[i]);
+}
+
+// a live set of BLOCKS where random slots are freed and refilled with a
+// different size, which is what fragments a first-fit free list
+static void run_churn(void *arg) {
+    Job *job = arg;
+    alloc_all(job);
+    for (int i = 0; i < CHURN_OPS; i++) {
+        unsigned s = churn_slot[i];
+        job->allocator->release(job->ptrs[s]);
+        job->ptrs[s] = job->allocator->alloc(churn_size[i]);
+        if (!job->ptrs[s]) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    for (int i = 0; i < BLOCKS; i++)
+        job->allocator->release(job->ptrs[i]);
+}
+
+// one buffer doubled from 16 bytes to 1 MB, a growing vector's pattern
+static void run_realloc(void *arg) {
+    Job *job = arg;
+    void *p = NULL;
+    for (size_t n = MIN_SIZE; n <= REALLOC_TOP; n *= 2) {
+        p = job->allocator->resize(p, n);
+        if (!p) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        ((char *)p)[n - 1] = 1;
+    }
+    bench_consume(p);
+    job->allocator->release(p);
+}
+
+int main(int argc, char **argv) {
+    BenchSuite suite;
+    if (!bench_init(&suite, "allocator", argc, argv))
+        return 2;
+
+    make_patterns();
+    allocator_set_quiet(1);
+
+    static Job jobs[2];
+    const Allocator *allocators[2] = { &custom, &libc };
+    const char *names[2] = { "custom", "libc" };
+
+    struct {
+        const char *name;
+        void (*run)(void *);
+        double items;
+    } patterns[] = {
+        { "fifo_1000",     run_fifo,    2 * BLOCKS },
+        { "lifo_1000",     run_lifo,    2 * BLOCKS },
+        { "churn_20000",   run_churn,   2 * (BLOCKS + CHURN_OPS) },
+        { "realloc_to_1m", run_realloc, 17 },
+    };
+
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+        for (int a = 0; a < 2; a++) {
+            char name[64];
+            snprintf(name, sizeof(name), "%s/%s", names[a], patterns[p].name);
+
+            jobs[a].allocator = allocators[a];
+            Bench bench = {
+                name, fresh_arena, patterns[p].run, NULL,
+                &jobs[a], patterns[p].items, "call"
+            };
+            bench_run(&suite, &bench);
+        }
+    }
+
+    allocator_release();
+    return bench_finish(&suite);
+}
@@ -0,0 +1,95 @@
+// BouncingBall is a single-file program, so its kernels are benchmarked by
+// compiling that file in here with its main() renamed out of the way.
+#define main bouncingball_main
+#include "../BouncingBall/main.c"
+#undef main
+
+#include "harness.h"
+
+// The simulation step without a window: integration at 1M balls, the
+// grid collision pass at 100K, and the O(n^2) pass it replaced at 10K.
+
+#define UPDATE_BALLS  1000000
+#define GRID_BALLS    100000
+#define BRUTE_BALLS   10000
+
+typedef struct {
+    Balls balls;
+    BallGrid grid;
+    BallPool pool;
+    int count;
+    int contacts;
+} Job;
+
+static void check(int ok) {
+    if (!ok) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+}
+
+// every collision run starts from the same spread of balls
+static void fresh_balls(void *arg) {
+    Job *job = arg;
+    check(balls_init(&job->balls, job->count, 1));
+}
+
+static void fresh_grid(void *arg) {
+    Job *job = arg;
+    fresh_balls(job);
+    check(grid_init(&job->grid, &job->balls));
+}
+
+static void drop_balls(void *arg) {
+    Job *job = arg;
+    balls_free(&job->balls);
+}
+
+static void drop_grid(void *arg) {
+    Job *job = arg;
+    grid_free(&job->grid);
+    balls_free(&job->balls);
+}
+
+static void run_update(void *arg) {
+    Job *job = arg;
+    update_balls(&job->balls, &job->pool);
+}
+
+static void run_grid(void *arg) {
+    Job *job = arg;
+    job->contacts = collide_balls(&job->balls, &job->grid);
+    bench_consume(&job->contacts);
+}
+
+static void run_brute(void *arg) {
+    Job *job = arg;
+    job->contacts = collide_brute(&job->balls);
+    bench_consume(&job->contacts);
+}
+
+int main(int argc, char **argv) {
+    BenchSuite suite;
+    if (!bench_init(&suite, "bouncingball", argc, argv))
+        return 2;
+
+    static Job job;
+    ball_pool_init(&job.pool, 1);
+
+    job.count = UPDATE_BALLS;
+    check(balls_init(&job.balls, job.count, 1));
+    Bench update = { "update_balls_1m", NULL, run_update, NULL, &job, UPDATE_BALLS, "ball" };
+    bench_run(&suite, &update);
+    balls_free(&job.balls);
+
+    job.count = GRID_BALLS;
+    Bench grid = { "collide_grid_100k", fresh_grid, run_grid, drop_grid, &job, GRID_BALLS, "ball" };
+    bench_run(&suite, &grid);
+
+    job.count = BRUTE_BALLS;
+    Bench brute = { "collide_brute_10k", fresh_balls, run_brute, drop_balls, &job, BRUTE_BALLS, "ball" };
+    bench_run(&suite, &brute);
+
+    ball_pool_destroy(&job.pool);
+    return bench_finish(&suite);
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dynarray.h"
+#include "harness.h"
+
+// The growable int array from Dynamicarray/. Built twice: bench_dynarray
+// against the C heap, bench_dynarray_cm with USE_CUSTOM_ALLOCATOR so every
+// growth goes through my_realloc.
+#ifdef USE_CUSTOM_ALLOCATOR
+#include "allocator.h"
+#define SUITE_NAME "dynarray (custom allocator)"
+#define BENCH_ARENA (64u * 1024 * 1024)
+#else
+#define SUITE_NAME "dynarray"
+#endif
+
+#define PUSHES  1000000
+#define SHIFTS  10000
+
+typedef struct {
+    DynArray da;
+    long long sum;
+} Job;
+
+static void check(int ok) {
+    if (!ok) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+}
+
+static void empty_array(void *arg) {
+    Job *job = arg;
+#ifdef USE_CUSTOM_ALLOCATOR
+    // a fresh arena each run, so the moves don't depend on earlier runs
+    allocator_init(BENCH_ARENA);
+#endif
+    da_init(&job->da);
+}
+
+static void full_array(void *arg) {
+    Job *job = arg;
+    empty_array(job);
+    check(da_reserve(&job->da, PUSHES));
+    for (int i = 0; i < PUSHES; i++)
+        check(da_push(&job->da, i));
+}
+
+static void shift_array(void *arg) {
+    Job *job = arg;
+    empty_array(job);
+    check(da_reserve(&job->da, SHIFTS));
+    for (int i = 0; i < SHIFTS; i++)
+        check(da_push(&job->da, i));
+}
+
+static void drop_array(void *arg) {
+    Job *job = arg;
+    da_free(&job->da);
+}
+
+static void run_push(void *arg) {
+    Job *job = arg;
+    for (int i = 0; i < PUSHES; i++)
+        check(da_push(&job->da, i));
+    bench_consume(job->da.data);
+}
+
+static void run_push_reserved(void *arg) {
+    Job *job = arg;
+    check(da_reserve(&job->da, PUSHES));
+    for (int i = 0; i < PUSHES; i++)
+        check(da_push(&job->da, i));
+    bench_consume(job->da.data);
+}
+
+static void run_get(void *arg) {
+    Job *job = arg;
+    long long sum = 0;
+    int v;
+    for (size_t i = 0; i < PUSHES; i++) {
+        da_get(&job->da, i, &v);
+        sum += v;
+    }
+    job->sum = sum;
+    bench_consume(&job->sum);
+}
+
+static void run_pop(void *arg) {
+    Job *job = arg;
+    long long sum = 0;
+    int v;
+    while (da_pop(&job->da, &v))
+        sum += v;
+    job->sum = sum;
+    bench_consume(&job->sum);
+}
+
+// every insert and remove at the front moves the whole array
+static void run_insert_front(void *arg) {
+    Job *job = arg;
+    for (int i = 0; i < SHIFTS; i++)
+        check(da_insert(&job->da, 0, i));
+    bench_consume(job->da.data);
+}
+
+static void run_remove_front(void *arg) {
+    Job *job = arg;
+    for (int i = 0; i < SHIFTS; i++)
+        da_remove(&job->da, 0);
+    bench_consume(job->da.data);
+}
+
+int main(int argc, char **argv) {
+    BenchSuite suite;
+    if (!bench_init(&suite, SUITE_NAME, argc, argv))
+        return 2;
+
+#ifdef USE_CUSTOM_ALLOCATOR
+    allocator_set_quiet(1);
+#endif
+
+    Job job;
+    Bench benches[] = {
+        { "push_1m",          empty_array, run_push,          drop_array, &job, PUSHES, "element" },
+        { "push_1m_reserved", empty_array, run_push_reserved, drop_array, &job, PUSHES, "element" },
+        { "get_1m",           full_array,  run_get,           drop_array, &job, PUSHES, "element" },
+        { "pop_1m",           full_array,  run_pop,           drop_array, &job, PUSHES, "element" },
+        { "insert_front_10k", empty_array, run_insert_front,  drop_array, &job, SHIFTS, "element" },
+        { "remove_front_10k", shift_array, run_remove_front,  drop_array, &job, SHIFTS, "element" },
+    };
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+        bench_run(&suite, &benches[i]);
+
+#ifdef USE_CUSTOM_ALLOCATOR
+    allocator_release();
+#endif
+    return bench_finish(&suite);
+}
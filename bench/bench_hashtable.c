@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashtable.h"
+#include "harness.h"
+
+// The open-addressing table from HashTable/. Built twice: bench_hashtable
+// against the C heap, bench_hashtable_cm with USE_CUSTOM_ALLOCATOR so
+// ht_create takes its table from the CoustomCalMal arena. The table is a
+// fixed array, so that one allocation is all it makes: insert and get run
+// the same code in both builds, and only create_destroy_1k compares the
+// allocators.
+#ifdef USE_CUSTOM_ALLOCATOR
+#include "allocator.h"
+#define SUITE_NAME "hashtable (custom allocator)"
+#else
+#define SUITE_NAME "hashtable"
+#endif
+
+#define KEYS      75            // 75% load, where linear probing starts to hurt
+#define LOOKUPS   100000
+#define CREATES   1000
+
+static char keys[KEYS][32];
+static char missing[KEYS][32];
+
+typedef struct {
+    HashTable *ht;
+    int found;
+} Job;
+
+static void make_keys(void) {
+    for (int i = 0; i < KEYS; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "person-%d", i * 7919);
+        snprintf(missing[i], sizeof(missing[i]), "nobody-%d", i * 104729);
+    }
+}
+
+static void fill(HashTable *ht) {
+    for (int i = 0; i < KEYS; i++)
+        ht_insert(ht, keys[i], i);
+}
+
+static void new_table(void *arg) {
+    Job *job = arg;
+    job->ht = ht_create();
+    if (!job->ht) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+}
+
+static void filled_table(void *arg) {
+    Job *job = arg;
+    new_table(job);
+    fill(job->ht);
+}
+
+static void drop_table(void *arg) {
+    Job *job = arg;
+    ht_destroy(job->ht);
+    job->ht = NULL;
+}
+
+static void run_insert(void *arg) {
+    Job *job = arg;
+    fill(job->ht);
+    bench_consume(job->ht);
+}
+
+static void run_hits(void *arg) {
+    Job *job = arg;
+    Person p;
+    int found = 0;
+    for (int i = 0; i < LOOKUPS; i++)
+        found += ht_get(job->ht, keys[i % KEYS], &p);
+    job->found = found;
+    bench_consume(&job->found);
+}
+
+// a miss probes until it reaches an empty slot, the worst case at 75% load
+static void run_misses(void *arg) {
+    Job *job = arg;
+    Person p;
+    int found = 0;
+    for (int i = 0; i < LOOKUPS; i++)
+        found += ht_get(job->ht, missing[i % KEYS], &p);
+    job->found = found;
+    bench_consume(&job->found);
+}
+
+static void run_create_destroy(void *arg) {
+    (void)arg;
+    for (int i = 0; i < CREATES; i++) {
+        HashTable *ht = ht_create();
+        bench_consume(ht);
+        ht_destroy(ht);
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchSuite suite;
+    if (!bench_init(&suite, SUITE_NAME, argc, argv))
+        return 2;
+
+#ifdef USE_CUSTOM_ALLOCATOR
+    allocator_set_quiet(1);
+    allocator_init(64u * 1024 * 1024);
+#endif
+    make_keys();
+
+    Job job = { NULL, 0 };
+    Bench benches[] = {
+        { "insert_75",          new_table,    run_insert,         drop_table, &job, KEYS,    "insert" },
+        { "get_hit_100k",       filled_table, run_hits,           drop_table, &job, LOOKUPS, "lookup" },
+        { "get_miss_100k",      filled_table, run_misses,         drop_table, &job, LOOKUPS, "lookup" },
+        { "create_destroy_1k",  NULL,         run_create_destroy, NULL,       &job, CREATES, "table" },
+    };
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+        bench_run(&suite, &benches[i]);
+
+#ifdef USE_CUSTOM_ALLOCATOR
+    allocator_release();
+#endif
+    return bench_finish(&suite);
+}
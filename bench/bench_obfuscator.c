@@ -0,0 +1,100 @@
+// The obfuscator is a single-file program, so its kernels are benchmarked
+// by compiling that file in here with its main() renamed out of the way.
+#define main obfuscator_main
+#include "../obfuscator/main.c"
+#undef main
+
+#include "harness.h"
+
+// The transform kernels over one buffer in memory, no I/O: what each
+// costs per byte, and how a SlicePool scales across every CPU.
+
+#define BUFFER_BYTES (16u << 20)
+#define CHARS_BYTES  (1u << 20)     // the getc/putc loop is ~100x slower
+
+typedef struct {
+    unsigned char *buf;
+    size_t len;
+    Cipher cipher;
+    SlicePool pool;
+} Job;
+
+static void run_transform_block(void *arg) {
+    Job *job = arg;
+    transform_block(job->buf, job->len);
+}
+
+static void run_cipher(void *arg) {
+    Job *job = arg;
+    job->cipher.apply(job->buf, job->len, &job->cipher.key, 0);
+}
+
+static void run_parallel(void *arg) {
+    Job *job = arg;
+    slice_pool_apply(&job->pool, job->buf, job->len, 0);
+}
+
+// the original byte loop, through stdio on both ends
+static void run_chars(void *arg) {
+    Job *job = arg;
+    FILE *in = fmemopen(job->buf, job->len, "rb");
+    FILE *out = fopen(NULL_DEVICE, "wb");
+    if (!in || !out) {
+        perror("run_chars");
+        exit(1);
+    }
+    stream_chars(in, out);
+    fclose(in);
+    fclose(out);
+}
+
+int main(int argc, char **argv) {
+    BenchSuite suite;
+    if (!bench_init(&suite, "obfuscator", argc, argv))
+        return 2;
+
+    unsigned char *buf = malloc(BUFFER_BYTES);
+    if (!buf) {
+        perror("malloc");
+        return 1;
+    }
+    fill_text(buf, BUFFER_BYTES);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus < 1 ? 1 : cpus > MAX_THREADS ? MAX_THREADS : (int)cpus;
+
+    Job job;
+    memset(&job, 0, sizeof(job));
+    job.buf = buf;
+    key_from_passphrase(&job.cipher.key, "bench");
+
+    job.len = CHARS_BYTES;
+    Bench chars = { "chars_1m", NULL, run_chars, NULL, &job, CHARS_BYTES, "byte" };
+    bench_run(&suite, &chars);
+
+    job.len = BUFFER_BYTES;
+    Bench block = { "transform_block_16m", NULL, run_transform_block, NULL,
+                    &job, BUFFER_BYTES, "byte" };
+    bench_run(&suite, &block);
+
+    for (size_t i = 0; i < sizeof(transforms) / sizeof(transforms[0]); i++) {
+        if (transforms[i].apply == none_apply)
+            continue;
+
+        char name[64];
+        job.cipher.apply = transforms[i].apply;
+
+        snprintf(name, sizeof(name), "%s_16m", transforms[i].name);
+        Bench single = { name, NULL, run_cipher, NULL, &job, BUFFER_BYTES, "byte" };
+        bench_run(&suite, &single);
+
+        snprintf(name, sizeof(name), "%s_16m_threads%d", transforms[i].name, threads);
+        Bench parallel = { name, NULL, run_parallel, NULL, &job, BUFFER_BYTES, "byte" };
+        slice_pool_init(&job.pool, &job.cipher, threads);
+        bench_run(&suite, &parallel);
+        slice_pool_destroy(&job.pool);
+    }
+
+    free(buf);
+    return bench_finish(&suite);
+}
@@ -0,0 +1,62 @@
+// Ping Pong is a single-file program, so its game logic is benchmarked by
+// compiling that file in here with its main() renamed out of the way.
+#define main pingpong_main
+#include "../Ping Pong/main.c"
+#undef main
+
+#include "harness.h"
+
+// The headless game: raw match_step throughput, and whole self-play
+// matches between two of the built-in policies.
+
+#define STEPS   100000
+#define MATCHES 100
+
+typedef struct {
+    Match match;
+    SelfPlayJob selfplay;
+} Job;
+
+static void run_steps(void *arg) {
+    Job *job = arg;
+    Match *m = &job->match;
+    match_init(m, 1);
+    for (int i = 0; i < STEPS; i++) {
+        if (m->state == GAME_WAIT)
+            match_serve(m);
+        match_step(m, predict_policy, track_policy, 1.0f);
+    }
+    bench_consume(m);
+}
+
+static void run_matches(void *arg) {
+    Job *job = arg;
+    SelfPlayJob *s = &job->selfplay;
+    memset(s, 0, sizeof(*s));
+    s->left = predict_policy;
+    s->right = noisy_policy;
+    s->dt = 1.0f;
+    s->points = MATCH_POINTS;
+    s->seed = 1;
+    s->first = 0;
+    s->last = MATCHES;
+    selfplay_worker(s);
+    bench_consume(s);
+}
+
+int main(int argc, char **argv) {
+    BenchSuite suite;
+    if (!bench_init(&suite, "pingpong", argc, argv))
+        return 2;
+
+    static Job job;
+    Bench benches[] = {
+        { "match_step_100k",      NULL, run_steps,   NULL, &job, STEPS,   "step" },
+        { "selfplay_100_matches", NULL, run_matches, NULL, &job, MATCHES, "match" },
+    };
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+        bench_run(&suite, &benches[i]);
+
+    return bench_finish(&suite);
+}
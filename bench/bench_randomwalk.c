@@ -0,0 +1,63 @@
+// randomwalk is a single-file program, so its kernels are benchmarked by
+// compiling that file in here with its main() renamed out of the way.
+#define main randomwalk_main
+#include "../randomwalk/main.c"
+#undef main
+
+#include "harness.h"
+
+// One frame's CPU work at 1M agents, stage by stage: the walk, the trail
+// fade and the plot into the framebuffer. No window is opened.
+
+#define AGENTS 1000000
+
+typedef struct {
+    Agents agents;
+    WalkRng rng;
+    WalkPool pool;
+    Framebuffer fb;
+} Job;
+
+static void run_update(void *arg) {
+    Job *job = arg;
+    update_agents(&job->agents, &job->rng, &job->pool, 1, NULL);
+}
+
+static void run_fade(void *arg) {
+    Job *job = arg;
+    fade_framebuffer(&job->fb);
+}
+
+static void run_plot(void *arg) {
+    Job *job = arg;
+    plot_agents(&job->fb, &job->agents);
+}
+
+int main(int argc, char **argv) {
+    BenchSuite suite;
+    if (!bench_init(&suite, "randomwalk", argc, argv))
+        return 2;
+
+    static Job job;
+    if (!agents_init(&job.agents, AGENTS) || !framebuffer_init(&job.fb)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    rng_seed(&job.rng, 1);
+    walk_pool_init(&job.pool, 1);
+
+    Bench benches[] = {
+        { "update_agents_1m", NULL, run_update, NULL, &job, AGENTS, "agent" },
+        { "fade_framebuffer", NULL, run_fade,   NULL, &job,
+          (double)(WIDTH + 1) * (HEIGHT + 1), "pixel" },
+        { "plot_agents_1m",   NULL, run_plot,   NULL, &job, AGENTS, "agent" },
+    };
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+        bench_run(&suite, &benches[i]);
+
+    walk_pool_destroy(&job.pool);
+    framebuffer_free(&job.fb);
+    agents_free(&job.agents);
+    return bench_finish(&suite);
+}
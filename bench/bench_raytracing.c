@@ -0,0 +1,84 @@
+/* RayTracing is a single-file program, so its lighting is benchmarked by
+ * compiling that file in here with its main() renamed out of the way. */
+#define main raytracing_main
+#include "../RayTracing/main.c"
+#undef main
+
+#include "harness.h"
+
+/* One frame of each lighting mode into an offscreen surface, with the
+ * sun and earth where RunBenchmark puts them. */
+
+typedef struct BenchScene {
+    SDL_Surface *surface;
+    Circle sun;
+    Circle earth;
+    SDL_Rect full;
+    RayTable table;
+    RayPool pool;
+    Uint8 *accum;
+} BenchScene;
+
+static void ClearSurface(void *arg) {
+    BenchScene *scene = arg;
+    SDL_FillRect(scene->surface, NULL, 0);
+}
+
+static void RunRays(void *arg) {
+    BenchScene *scene = arg;
+    DrawSunRays(scene->surface, scene->sun, scene->earth,
+                &scene->table, &scene->pool, &scene->full);
+}
+
+static void RunPolygon(void *arg) {
+    BenchScene *scene = arg;
+    DrawLightPolygon(scene->surface, scene->sun, &scene->earth, 1, &scene->full);
+}
+
+static void RunSoft(void *arg) {
+    BenchScene *scene = arg;
+    DrawLightSoft(scene->surface, scene->sun, &scene->earth, 1,
+                  scene->accum, &scene->full);
+}
+
+int main(int argc, char *argv[]) {
+    BenchSuite suite;
+    if (!bench_init(&suite, "raytracing", argc, argv))
+        return 2;
+
+    static BenchScene scene;
+    scene.surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_RGB888);
+    scene.accum = calloc(WIDTH * HEIGHT, 1);
+    if (!scene.surface || !scene.accum) {
+        fprintf(stderr, "Surface creation failed: %s\n", SDL_GetError());
+        return 1;
+    }
+    scene.sun = (Circle){500, 400, 140};
+    scene.earth = (Circle){750, 400, 80};
+    scene.full = (SDL_Rect){0, 0, WIDTH, HEIGHT};
+    RayPoolInit(&scene.pool, 1);
+
+    static const int rayCounts[] = { RAY_COUNT, 100000 };
+    for (int r = 0; r < 2; r++) {
+        char name[64];
+        snprintf(name, sizeof(name), "rays_%d", rayCounts[r]);
+        BuildRayTable(&scene.table, rayCounts[r]);
+        Bench rays = { name, ClearSurface, RunRays, NULL, &scene, rayCounts[r], "ray" };
+        bench_run(&suite, &rays);
+        FreeRayTable(&scene.table);
+    }
+
+    Bench polygon = { "polygon", ClearSurface, RunPolygon, NULL, &scene,
+                      (double)WIDTH * HEIGHT, "pixel" };
+    bench_run(&suite, &polygon);
+
+    Bench soft = { "soft", ClearSurface, RunSoft, NULL, &scene,
+                   (double)WIDTH * HEIGHT, "pixel" };
+    bench_run(&suite, &soft);
+
+    RayPoolDestroy(&scene.pool);
+    free(scene.accum);
+    SDL_FreeSurface(scene.surface);
+    return bench_finish(&suite);
+}
@@ -0,0 +1,351 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "harness.h"
+
+static const char *counter_names[COUNTER_COUNT] = {
+    "cycles", "instructions", "cache_misses", "branch_misses", "page_faults"
+};
+
+double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static const void *volatile sink;
+
+void bench_consume(const void *p) {
+    sink = p;
+}
+
+// One counter, user space only: that is what the default
+// perf_event_paranoid (2) allows without privileges. -1 if unavailable,
+// e.g. in a VM without a PMU or under a seccomp filter.
+//
+// All counters join the group of the first one that opens (group -1 makes
+// a new leader), so the kernel schedules them together and a multiplexed
+// run scales them all alike. inherit extends them to every thread the
+// benchmark starts, such as the obfuscator's slice workers.
+static int open_counter(int counter, int group) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.disabled = group < 0;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter) {
+    case COUNTER_CYCLES:        attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case COUNTER_INSTRUCTIONS:  attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case COUNTER_CACHE_MISSES:  attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+    case COUNTER_BRANCH_MISSES: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    case COUNTER_PAGE_FAULTS:
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+        break;
+    }
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+#else
+    (void)counter;
+    (void)group;
+    return -1;
+#endif
+}
+
+// Reads the whole group in one go: the count, the time enabled, the time
+// running, then the values in the order the counters joined.
+static int read_group(const BenchSuite *suite, unsigned long long *group) {
+#ifdef __linux__
+    size_t size = sizeof(*group) * (3 + COUNTER_COUNT);
+    return read(suite->leader, group, size) > 0;
+#else
+    (void)suite;
+    (void)group;
+    return 0;
+#endif
+}
+
+// The counts are read as differences rather than reset, because a reset
+// does not clear what threads that have already exited added to them.
+static void counters_start(BenchSuite *suite) {
+#ifdef __linux__
+    if (suite->leader < 0)
+        return;
+    if (!read_group(suite, suite->group_start))
+        suite->group_start[0] = 0;
+    ioctl(suite->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void)suite;
+#endif
+}
+
+// Scales each count by time enabled / time running, which is what the
+// kernel left out while it had the group off the PMU to run others.
+static void counters_stop(BenchSuite *suite, double *out) {
+    unsigned long long now[3 + COUNTER_COUNT];
+    const unsigned long long *start = suite->group_start;
+
+    for (int c = 0; c < COUNTER_COUNT; c++)
+        out[c] = -1.0;
+    if (suite->leader < 0)
+        return;
+#ifdef __linux__
+    ioctl(suite->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    if (!start[0] || !read_group(suite, now))
+        return;
+
+    double enabled = (double)(now[1] - start[1]);
+    double running = (double)(now[2] - start[2]);
+    if (running <= 0.0)
+        return;
+
+    int slot = 0;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (suite->fds[c] < 0)
+            continue;
+        out[c] = (double)(now[3 + slot] - start[3 + slot]) * enabled / running;
+        slot++;
+    }
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+        "usage: %s [--warmup N] [--repeats N] [--filter TEXT] [--json PATH]\n"
+        "          [--no-counters]\n", program);
+}
+
+int bench_init(BenchSuite *suite, const char *name, int argc, char **argv) {
+    memset(suite, 0, sizeof(*suite));
+    suite->suite = name;
+    suite->warmup = 3;
+    suite->repeats = 20;
+    suite->use_counters = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+            suite->warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc)
+            suite->repeats = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            suite->filter = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            suite->json_path = argv[++i];
+        else if (strcmp(argv[i], "--no-counters") == 0)
+            suite->use_counters = 0;
+        else {
+            usage(argv[0]);
+            return 0;
+        }
+    }
+    if (suite->warmup < 0) suite->warmup = 0;
+    if (suite->repeats < 1) suite->repeats = 1;
+
+    int available = 0;
+    suite->leader = -1;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        suite->fds[c] = suite->use_counters ? open_counter(c, suite->leader) : -1;
+        if (suite->fds[c] >= 0 && suite->leader < 0)
+            suite->leader = suite->fds[c];
+        available += suite->fds[c] >= 0;
+    }
+
+    // with --json - the JSON owns stdout, so the table goes to stderr
+    FILE *out = (suite->json_path && strcmp(suite->json_path, "-") == 0) ? stderr : stdout;
+    fprintf(out, "%s: warmup %d, repeats %d, counters:", name,
+            suite->warmup, suite->repeats);
+    for (int c = 0; c < COUNTER_COUNT; c++)
+        if (suite->fds[c] >= 0)
+            fprintf(out, " %s", counter_names[c]);
+    fprintf(out, "%s\n\n", available ? " (all threads)" : " none");
+    fprintf(out, "%-34s %10s %10s %10s %10s %12s %9s %6s %10s %10s %8s\n",
+            "benchmark", "min", "p50", "p90", "p99", "p50/item",
+            "cyc/item", "IPC", "llc-miss", "br-miss", "faults");
+    return 1;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of a sorted array
+static double percentile(const double *sorted, int n, double p) {
+    int rank = (int)(p / 100.0 * n + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+static const char *format_ns(double ns, char *buf, size_t size) {
+    if (ns < 10.0)      snprintf(buf, size, "%.3f ns", ns);
+    else if (ns < 1e3)  snprintf(buf, size, "%.1f ns", ns);
+    else if (ns < 1e6)  snprintf(buf, size, "%.2f us", ns / 1e3);
+    else if (ns < 1e9)  snprintf(buf, size, "%.2f ms", ns / 1e6);
+    else                snprintf(buf, size, "%.3f s", ns / 1e9);
+    return buf;
+}
+
+void bench_run(BenchSuite *suite, const Bench *bench) {
+    if (suite->filter && !strstr(bench->name, suite->filter))
+        return;
+    if (suite->result_count == BENCH_MAX_RESULTS) {
+        fprintf(stderr, "%s: more than %d benchmarks, skipped\n",
+                bench->name, BENCH_MAX_RESULTS);
+        return;
+    }
+
+    int n = suite->repeats;
+    double *ns = malloc(sizeof(double) * n);
+    double *counts = malloc(sizeof(double) * n * COUNTER_COUNT);
+    double *column = malloc(sizeof(double) * n);
+    if (!ns || !counts || !column) {
+        fprintf(stderr, "%s: out of memory\n", bench->name);
+        exit(1);
+    }
+
+    for (int r = -suite->warmup; r < n; r++) {
+        if (bench->setup)
+            bench->setup(bench->arg);
+
+        if (r >= 0)
+            counters_start(suite);
+        double t0 = bench_now_ns();
+        bench->run(bench->arg);
+        double t = bench_now_ns() - t0;
+        if (r >= 0) {
+            counters_stop(suite, &counts[r * COUNTER_COUNT]);
+            ns[r] = t;
+        }
+
+        if (bench->teardown)
+            bench->teardown(bench->arg);
+    }
+
+    BenchResult *res = &suite->results[suite->result_count++];
+    snprintf(res->name, sizeof(res->name), "%s", bench->name);
+    res->unit = bench->unit ? bench->unit : "item";
+    res->items = bench->items > 0.0 ? bench->items : 1.0;
+    res->runs = n;
+
+    double sum = 0.0;
+    for (int r = 0; r < n; r++)
+        sum += ns[r];
+    qsort(ns, n, sizeof(double), compare_doubles);
+    res->min = ns[0];
+    res->p50 = percentile(ns, n, 50.0);
+    res->p90 = percentile(ns, n, 90.0);
+    res->p99 = percentile(ns, n, 99.0);
+    res->max = ns[n - 1];
+    res->mean = sum / n;
+
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        for (int r = 0; r < n; r++)
+            column[r] = counts[r * COUNTER_COUNT + c];
+        qsort(column, n, sizeof(double), compare_doubles);
+        res->counters[c] = column[0] < 0.0 ? -1.0 : percentile(column, n, 50.0);
+    }
+
+    char a[24], b[24], c[24], d[24], e[24];
+    char cycles[16] = "-", ipc[16] = "-", llc[16] = "-", branch[16] = "-";
+    char faults[16] = "-";
+    const double *k = res->counters;
+    if (k[COUNTER_CYCLES] >= 0.0)
+        snprintf(cycles, sizeof(cycles), "%.2f", k[COUNTER_CYCLES] / res->items);
+    if (k[COUNTER_CYCLES] > 0.0 && k[COUNTER_INSTRUCTIONS] >= 0.0)
+        snprintf(ipc, sizeof(ipc), "%.2f", k[COUNTER_INSTRUCTIONS] / k[COUNTER_CYCLES]);
+    if (k[COUNTER_CACHE_MISSES] >= 0.0)
+        snprintf(llc, sizeof(llc), "%.4f", k[COUNTER_CACHE_MISSES] / res->items);
+    if (k[COUNTER_BRANCH_MISSES] >= 0.0)
+        snprintf(branch, sizeof(branch), "%.4f", k[COUNTER_BRANCH_MISSES] / res->items);
+    if (k[COUNTER_PAGE_FAULTS] >= 0.0)
+        snprintf(faults, sizeof(faults), "%.0f", k[COUNTER_PAGE_FAULTS]);
+
+    FILE *out = (suite->json_path && strcmp(suite->json_path, "-") == 0) ? stderr : stdout;
+    fprintf(out, "%-34s %10s %10s %10s %10s %12s %9s %6s %10s %10s %8s\n",
+            res->name,
+            format_ns(res->min, a, sizeof(a)),
+            format_ns(res->p50, b, sizeof(b)),
+            format_ns(res->p90, c, sizeof(c)),
+            format_ns(res->p99, d, sizeof(d)),
+            format_ns(res->p50 / res->items, e, sizeof(e)),
+            cycles, ipc, llc, branch, faults);
+    fflush(out);
+
+    free(column);
+    free(counts);
+    free(ns);
+}
+
+static void write_json(const BenchSuite *suite, FILE *f) {
+    fprintf(f, "{\n  \"suite\": \"%s\",\n", suite->suite);
+    fprintf(f, "  \"warmup\": %d,\n  \"repeats\": %d,\n", suite->warmup, suite->repeats);
+    fprintf(f, "  \"benchmarks\": [");
+
+    for (int i = 0; i < suite->result_count; i++) {
+        const BenchResult *r = &suite->results[i];
+        fprintf(f, "%s\n    {\n", i ? "," : "");
+        fprintf(f, "      \"name\": \"%s\",\n", r->name);
+        fprintf(f, "      \"items\": %.0f,\n      \"unit\": \"%s\",\n", r->items, r->unit);
+        fprintf(f, "      \"runs\": %d,\n", r->runs);
+        fprintf(f, "      \"ns\": { \"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, "
+                   "\"p99\": %.1f, \"max\": %.1f, \"mean\": %.1f },\n",
+                r->min, r->p50, r->p90, r->p99, r->max, r->mean);
+        fprintf(f, "      \"ns_per_item\": %.4f,\n", r->p50 / r->items);
+        fprintf(f, "      \"counters\": {");
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            fprintf(f, "%s \"%s\": ", c ? "," : "", counter_names[c]);
+            if (r->counters[c] < 0.0)
+                fprintf(f, "null");
+            else
+                fprintf(f, "%.0f", r->counters[c]);
+        }
+        fprintf(f, " }\n    }");
+    }
+    fprintf(f, "\n  ]\n}\n");
+}
+
+int bench_finish(BenchSuite *suite) {
+    int result = 0;
+
+    if (suite->json_path) {
+        int to_stdout = strcmp(suite->json_path, "-") == 0;
+        FILE *f = to_stdout ? stdout : fopen(suite->json_path, "w");
+        if (f) {
+            write_json(suite, f);
+            if (!to_stdout)
+                fclose(f);
+        } else {
+            perror(suite->json_path);
+            result = 1;
+        }
+    }
+
+#ifdef __linux__
+    for (int c = 0; c < COUNTER_COUNT; c++)
+        if (suite->fds[c] >= 0)
+            close(suite->fds[c]);
+#endif
+    return result;
+}
@@ -0,0 +1,75 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <stdio.h>
+
+// The micro-benchmark harness every bench_* executable shares. Each
+// benchmark runs `warmup` untimed times, then `repeats` timed times; the
+// report gives percentiles of the run times, time per item, and the median
+// hardware counts per run when perf_event_open allows them. The counts take
+// in every thread a run starts and are scaled up when the kernel had to
+// multiplex them.
+//
+// Command line, the same for every bench_* program:
+//   --warmup N      untimed runs first (default 3)
+//   --repeats N     timed runs (default 20)
+//   --filter TEXT   only benchmarks whose name contains TEXT
+//   --json PATH     also write the results as JSON ("-" for stdout)
+//   --no-counters   skip perf_event_open
+
+#define BENCH_MAX_RESULTS 128
+
+enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_PAGE_FAULTS,
+    COUNTER_COUNT
+};
+
+typedef struct {
+    const char *name;
+    void (*setup)(void *arg);       // untimed, before every run; may be NULL
+    void (*run)(void *arg);         // the timed part
+    void (*teardown)(void *arg);    // untimed, after every run; may be NULL
+    void *arg;
+    double items;                   // work per run (elements, bytes, ...)
+    const char *unit;               // what an item is, for the report
+} Bench;
+
+typedef struct {
+    char name[96];
+    const char *unit;
+    double items;
+    int runs;
+    double min, p50, p90, p99, max, mean;   // ns per run
+    double counters[COUNTER_COUNT];         // per run (median); -1 = n/a
+} BenchResult;
+
+typedef struct {
+    const char *suite;
+    int warmup;
+    int repeats;
+    const char *filter;
+    const char *json_path;
+    int use_counters;
+    int fds[COUNTER_COUNT];         // -1 where a counter isn't available
+    int leader;                     // the group's first fd, or -1 for none
+    unsigned long long group_start[3 + COUNTER_COUNT];  // read at run start
+    BenchResult results[BENCH_MAX_RESULTS];
+    int result_count;
+} BenchSuite;
+
+// Reads the shared options; returns 0 on a bad command line.
+int bench_init(BenchSuite *suite, const char *name, int argc, char **argv);
+void bench_run(BenchSuite *suite, const Bench *bench);
+// Prints the JSON if asked for and closes the counters; returns the exit code.
+int bench_finish(BenchSuite *suite);
+
+// Keeps the compiler from optimizing away a result nobody reads.
+void bench_consume(const void *p);
+
+double bench_now_ns(void);
+
+#endif
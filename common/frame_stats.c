@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "frame_stats.h"
+
+void frame_timer_init(FrameTimer *timer, int capacity) {
+    timer->frames = 0;
+    for (int i = 0; i < STAGE_COUNT; i++)
+        timer->ms[i] = calloc(capacity, sizeof(double));
+    timer->mark = SDL_GetPerformanceCounter();
+}
+
+void frame_timer_free(FrameTimer *timer) {
+    for (int i = 0; i < STAGE_COUNT; i++)
+        free(timer->ms[i]);
+}
+
+void frame_timer_stage(FrameTimer *timer, int stage) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    timer->ms[stage][timer->frames] +=
+        (now - timer->mark) * 1000.0 / SDL_GetPerformanceFrequency();
+    timer->mark = now;
+}
+
+void frame_timer_skip(FrameTimer *timer) {
+    timer->mark = SDL_GetPerformanceCounter();
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+void print_times(const char *name, double *ms, int n) {
+    qsort(ms, n, sizeof(double), compare_doubles);
+    printf("%-8s %9.3f %9.3f %9.3f\n", name,
+           ms[0], ms[(n - 1) / 2], ms[(int)((n - 1) * 0.99 + 0.5)]);
+}
+
+void print_frame_stats(FrameTimer *timer, int show_stages) {
+    static const char *names[STAGE_COUNT] = { "update", "raster", "present" };
+    int n = timer->frames;
+    double *total = calloc(n, sizeof(double));
+
+    for (int f = 0; f < n; f++)
+        for (int i = 0; i < STAGE_COUNT; i++)
+            total[f] += timer->ms[i][f];
+
+    printf("%d frames\n%-8s %9s %9s %9s\n", n, "stage", "min ms", "p50 ms", "p99 ms");
+    print_times("frame", total, n);
+    if (show_stages)
+        for (int i = 0; i < STAGE_COUNT; i++)
+            print_times(names[i], timer->ms[i], n);
+
+    free(total);
+}
+
+int save_ppm(SDL_Surface *surface, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return 0;
+
+    fprintf(file, "P6\n%d %d\n255\n", surface->w, surface->h);
+
+    SDL_LockSurface(surface);
+    for (int y = 0; y < surface->h; y++) {
+        Uint32 *row = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch);
+        for (int x = 0; x < surface->w; x++) {
+            Uint8 rgb[3];
+            SDL_GetRGB(row[x], surface->format, &rgb[0], &rgb[1], &rgb[2]);
+            fwrite(rgb, 1, 3, file);
+        }
+    }
+    SDL_UnlockSurface(surface);
+
+    fclose(file);
+    return 1;
+}
@@ -0,0 +1,38 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <SDL2/SDL.h>
+
+// Frame timing and frame dumps for the --headless modes of the SDL
+// chapters (Bouncing Ball, Ping Pong, Ray Casting, Random Walk), so all
+// four report their frames in the same table.
+
+enum { STAGE_UPDATE, STAGE_RASTER, STAGE_PRESENT, STAGE_COUNT };
+
+// per-frame stage times in milliseconds
+typedef struct {
+    int frames;
+    double *ms[STAGE_COUNT];
+    Uint64 mark;
+} FrameTimer;
+
+void frame_timer_init(FrameTimer *timer, int capacity);
+void frame_timer_free(FrameTimer *timer);
+
+// charge the time since the last mark to a stage of the current frame
+void frame_timer_stage(FrameTimer *timer, int stage);
+
+// restart the clock without charging anything, e.g. at the start of a
+// frame or after dumping one
+void frame_timer_skip(FrameTimer *timer);
+
+// sorts ms and prints its min, median and 99th percentile as one row
+void print_times(const char *name, double *ms, int n);
+
+// whole-frame times, plus one row per stage with show_stages
+void print_frame_stats(FrameTimer *timer, int show_stages);
+
+// binary PPM dump, used for golden-image checks; 0 if it can't be written
+int save_ppm(SDL_Surface *surface, const char *path);
+
+#endif
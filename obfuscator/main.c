@@ -1,11 +1,1335 @@
+#ifdef __linux__
+#define _GNU_SOURCE             // splice, vmsplice, F_SETPIPE_SZ, copy_file_range
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#define NULL_DEVICE "/dev/null"
+#else
+#include <io.h>
+#define NULL_DEVICE "NUL"
+#endif
+
+#ifdef __linux__
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define BLOCK_SIZE (1 << 20)    // bytes per read() / write()
+#define MAP_WINDOW (64 << 20)   // bytes mapped at once in --inplace mode
+#define MAX_THREADS 64
+#define SLOTS_PER_THREAD 4      // blocks in flight per worker in the pipeline
+#define PIPE_BYTES (1 << 20)    // pipe size asked for in splice mode
+
  int transform(int c){
     return ~c;
  }
 
- int main(){
+// transform() over a whole buffer. 64 bytes per loop: two 32-byte XORs
+// with AVX2 or four 16-byte ones with SSE2. The tail goes byte by byte.
+void transform_block(unsigned char *buf, size_t n) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi8(-1);
+    for (; i + 64 <= n; i += 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(buf + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(buf + i + 32));
+        _mm256_storeu_si256((__m256i *)(buf + i), _mm256_xor_si256(a, ones));
+        _mm256_storeu_si256((__m256i *)(buf + i + 32), _mm256_xor_si256(b, ones));
+    }
+#elif defined(__SSE2__)
+    const __m128i ones = _mm_set1_epi8(-1);
+    for (; i + 64 <= n; i += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(buf + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(buf + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *)(buf + i + 48));
+        _mm_storeu_si128((__m128i *)(buf + i), _mm_xor_si128(a, ones));
+        _mm_storeu_si128((__m128i *)(buf + i + 16), _mm_xor_si128(b, ones));
+        _mm_storeu_si128((__m128i *)(buf + i + 32), _mm_xor_si128(c, ones));
+        _mm_storeu_si128((__m128i *)(buf + i + 48), _mm_xor_si128(d, ones));
+    }
+#endif
+
+    for (; i < n; i++)
+        buf[i] = (unsigned char)transform(buf[i]);
+}
+
+// A transform works on any slice of the stream given only the slice's
+// offset from the start, so slices can be done in any order, on any thread.
+// Every transform here is its own inverse: running it twice restores the
+// input.
+typedef struct {
+    uint64_t k[4];
+} Key;
+
+typedef void (*TransformFn)(unsigned char *buf, size_t n,
+                            const Key *key, uint64_t offset);
+
+typedef struct {
+    TransformFn apply;
+    Key key;
+} Cipher;
+
+// leaves the bytes alone; lets the zero-copy paths move them untouched
+void none_apply(unsigned char *buf, size_t n, const Key *key, uint64_t offset) {
+    (void)buf;
+    (void)n;
+    (void)key;
+    (void)offset;
+}
+
+// the original bitwise NOT; needs no key
+void not_apply(unsigned char *buf, size_t n, const Key *key, uint64_t offset) {
+    (void)key;
+    (void)offset;
+    transform_block(buf, n);
+}
+
+#define GOLDEN 0x9E3779B97F4A7C15ull
+
+// splitmix64 finalizer
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Keystream word i of a counter-based generator: the splitmix64 stream
+// seeded with k0, mix64(k0 + i * golden). No state carries from one word to
+// the next, so any offset can be jumped to directly. Byte j of the stream
+// is byte j % 8 of word j / 8, low first.
+static uint64_t counter_word(const Key *key, uint64_t i) {
+    return mix64(key->k[0] + i * GOLDEN);
+}
+
+void counter_apply(unsigned char *buf, size_t n, const Key *key, uint64_t offset) {
+    uint64_t word = offset / 8;
+    unsigned skip = (unsigned)(offset % 8);
+    size_t i = 0;
+
+    if (skip) {
+        uint64_t ks = counter_word(key, word++);
+        for (; skip < 8 && i < n; skip++, i++)
+            buf[i] ^= (unsigned char)(ks >> (8 * skip));
+    }
+
+    for (; i + 8 <= n; i += 8) {
+        uint64_t v, ks = counter_word(key, word++);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        ks = __builtin_bswap64(ks);
+#endif
+        memcpy(&v, buf + i, 8);
+        v ^= ks;
+        memcpy(buf + i, &v, 8);
+    }
+
+    if (i < n) {
+        uint64_t ks = counter_word(key, word);
+        for (unsigned j = 0; i < n; i++, j++)
+            buf[i] ^= (unsigned char)(ks >> (8 * j));
+    }
+}
+
+// ChaCha20 (20 rounds, 64-bit block counter, zero nonce). Block b of the
+// keystream covers stream bytes 64b..64b+63.
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define QUARTER(a, b, c, d) \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8);  \
+    c += d; b ^= c; b = ROTL32(b, 7);
+
+static void chacha_init(uint32_t s[16], const Key *key, uint64_t block) {
+    s[0] = 0x61707865; s[1] = 0x3320646e; s[2] = 0x79622d32; s[3] = 0x6b206574;
+    for (int i = 0; i < 4; i++) {
+        s[4 + 2 * i] = (uint32_t)key->k[i];
+        s[5 + 2 * i] = (uint32_t)(key->k[i] >> 32);
+    }
+    s[12] = (uint32_t)block;
+    s[13] = (uint32_t)(block >> 32);
+    s[14] = s[15] = 0;
+}
+
+static void chacha_block(const uint32_t in[16], unsigned char out[64]) {
+    uint32_t x[16];
+    memcpy(x, in, sizeof(x));
+
+    for (int r = 0; r < 10; r++) {
+        QUARTER(x[0], x[4], x[8],  x[12])
+        QUARTER(x[1], x[5], x[9],  x[13])
+        QUARTER(x[2], x[6], x[10], x[14])
+        QUARTER(x[3], x[7], x[11], x[15])
+        QUARTER(x[0], x[5], x[10], x[15])
+        QUARTER(x[1], x[6], x[11], x[12])
+        QUARTER(x[2], x[7], x[8],  x[13])
+        QUARTER(x[3], x[4], x[9],  x[14])
+    }
+
+    for (int i = 0; i < 16; i++) {
+        uint32_t v = x[i] + in[i];
+        out[4 * i]     = (unsigned char)v;
+        out[4 * i + 1] = (unsigned char)(v >> 8);
+        out[4 * i + 2] = (unsigned char)(v >> 16);
+        out[4 * i + 3] = (unsigned char)(v >> 24);
+    }
+}
+
+#ifdef __SSE2__
+#define ROTL128(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define QUARTER4(a, b, c, d) \
+    a = _mm_add_epi32(a, b); d = ROTL128(_mm_xor_si128(d, a), 16); \
+    c = _mm_add_epi32(c, d); b = ROTL128(_mm_xor_si128(b, c), 12); \
+    a = _mm_add_epi32(a, b); d = ROTL128(_mm_xor_si128(d, a), 8);  \
+    c = _mm_add_epi32(c, d); b = ROTL128(_mm_xor_si128(b, c), 7);
+
+// Four blocks side by side, one per lane, XORed into 256 bytes of buf.
+// Lane j runs block counter + j.
+static void chacha_xor4(const uint32_t in[16], unsigned char *buf) {
+    __m128i s[16], x[16];
+    for (int i = 0; i < 16; i++)
+        s[i] = _mm_set1_epi32((int)in[i]);
+
+    // 64-bit counter + lane, carrying into the high word
+    const __m128i bias = _mm_set1_epi32((int)0x80000000u);
+    __m128i lo = _mm_add_epi32(s[12], _mm_set_epi32(3, 2, 1, 0));
+    __m128i carry = _mm_cmplt_epi32(_mm_xor_si128(lo, bias),
+                                    _mm_xor_si128(s[12], bias));
+    s[13] = _mm_sub_epi32(s[13], carry);
+    s[12] = lo;
+
+    for (int i = 0; i < 16; i++)
+        x[i] = s[i];
+
+    for (int r = 0; r < 10; r++) {
+        QUARTER4(x[0], x[4], x[8],  x[12])
+        QUARTER4(x[1], x[5], x[9],  x[13])
+        QUARTER4(x[2], x[6], x[10], x[14])
+        QUARTER4(x[3], x[7], x[11], x[15])
+        QUARTER4(x[0], x[5], x[10], x[15])
+        QUARTER4(x[1], x[6], x[11], x[12])
+        QUARTER4(x[2], x[7], x[8],  x[13])
+        QUARTER4(x[3], x[4], x[9],  x[14])
+    }
+
+    // transpose each group of 4 words from lanes back into blocks
+    for (int g = 0; g < 16; g += 4) {
+        __m128i a = _mm_add_epi32(x[g],     s[g]);
+        __m128i b = _mm_add_epi32(x[g + 1], s[g + 1]);
+        __m128i c = _mm_add_epi32(x[g + 2], s[g + 2]);
+        __m128i d = _mm_add_epi32(x[g + 3], s[g + 3]);
+
+        __m128i ab_lo = _mm_unpacklo_epi32(a, b), ab_hi = _mm_unpackhi_epi32(a, b);
+        __m128i cd_lo = _mm_unpacklo_epi32(c, d), cd_hi = _mm_unpackhi_epi32(c, d);
+        __m128i out[4] = {
+            _mm_unpacklo_epi64(ab_lo, cd_lo), _mm_unpackhi_epi64(ab_lo, cd_lo),
+            _mm_unpacklo_epi64(ab_hi, cd_hi), _mm_unpackhi_epi64(ab_hi, cd_hi)
+        };
+
+        for (int k = 0; k < 4; k++) {
+            __m128i *p = (__m128i *)(buf + 64 * k + 4 * g);
+            _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), out[k]));
+        }
+    }
+}
+#endif
+
+void chacha_apply(unsigned char *buf, size_t n, const Key *key, uint64_t offset) {
+    uint32_t state[16];
+    unsigned char ks[64];
+    uint64_t block = offset / 64;
+    unsigned skip = (unsigned)(offset % 64);
+    size_t i = 0;
+
+    if (skip) {
+        chacha_init(state, key, block++);
+        chacha_block(state, ks);
+        for (; skip < 64 && i < n; skip++, i++)
+            buf[i] ^= ks[skip];
+    }
+
+#ifdef __SSE2__
+    for (; i + 256 <= n; i += 256, block += 4) {
+        chacha_init(state, key, block);
+        chacha_xor4(state, buf + i);
+    }
+#endif
+
+    for (; i < n; i += 64) {
+        size_t len = (n - i < 64) ? n - i : 64;
+        chacha_init(state, key, block++);
+        chacha_block(state, ks);
+        for (size_t j = 0; j < len; j++)
+            buf[i + j] ^= ks[j];
+    }
+}
+
+typedef struct {
+    const char *name;
+    TransformFn apply;
+    int keyed;
+} NamedTransform;
+
+static const NamedTransform transforms[] = {
+    { "none",    none_apply,    0 },
+    { "not",     not_apply,     0 },
+    { "counter", counter_apply, 1 },
+    { "chacha",  chacha_apply,  1 },
+};
+
+static const NamedTransform *find_transform(const char *name) {
+    for (size_t i = 0; i < sizeof(transforms) / sizeof(transforms[0]); i++)
+        if (strcmp(transforms[i].name, name) == 0)
+            return &transforms[i];
+    return NULL;
+}
+
+// Spreads a passphrase over the 256-bit key. This only makes the output
+// depend on the passphrase; it is not a password hash and offers no
+// protection against guessing.
+void key_from_passphrase(Key *key, const char *pass) {
+    uint64_t h = 0xCBF29CE484222325ull;   // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)pass; *p; p++)
+        h = (h ^ *p) * 0x100000001B3ull;
+
+    for (int i = 0; i < 4; i++)
+        key->k[i] = mix64(h + (uint64_t)(i + 1) * GOLDEN);
+}
+
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// The original loop: one getc/putc per byte.
+void stream_chars(FILE *in, FILE *out) {
     int c;
-    while((c=getchar()) != EOF){
-        putchar(transform(c));
+    while((c=getc(in)) != EOF){
+        putc(transform(c), out);
+    }
+}
+
+// write() can take less than it was given, and a signal can interrupt it
+int write_all(int fd, const unsigned char *buf, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, buf, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+// reads until n bytes or the end of the input; returns the count, -1 on error
+ssize_t read_full(int fd, unsigned char *buf, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = read(fd, buf + got, n - got);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (r == 0)
+            break;
+        got += (size_t)r;
+    }
+    return (ssize_t)got;
+}
+
+// read() a block, transform it where it lies, write() it out. A pipe hands
+// over whatever it has, so a block can be short; it is passed on as is.
+int stream_blocks(int in, int out, const Cipher *cipher) {
+    unsigned char *buf = malloc(BLOCK_SIZE);
+    if (!buf) {
+        perror("malloc");
+        return -1;
+    }
+
+    int result = 0;
+    uint64_t offset = 0;
+    for (;;) {
+        ssize_t n = read(in, buf, BLOCK_SIZE);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("read");
+            result = -1;
+            break;
+        }
+        if (n == 0)
+            break;
+
+        cipher->apply(buf, (size_t)n, &cipher->key, offset);
+        offset += (uint64_t)n;
+        if (write_all(out, buf, (size_t)n) < 0) {
+            perror("write");
+            result = -1;
+            break;
+        }
+    }
+
+    free(buf);
+    return result;
+}
+
+// One block of the parallel pipeline. Blocks are numbered in stream order;
+// block seq lives in slot seq % slot_count.
+typedef struct {
+    unsigned char *buf;
+    size_t len;
+    uint64_t offset;
+    int done;
+} Slot;
+
+// The calling thread reads blocks into free slots, the workers transform
+// them in any order, and one writer thread writes them out strictly in
+// sequence. One lock guards the three counters; the transform and the
+// read()/write() calls run outside it.
+typedef struct {
+    const Cipher *cipher;
+    int out;
+    Slot *slots;
+    long slot_count;
+    long next_fill;     // blocks read so far
+    long next_work;     // blocks handed to a worker
+    long next_write;    // blocks written
+    int finished;       // the reader hit the end of the input
+    int failed;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} Pipeline;
+
+static void *pipeline_worker(void *data) {
+    Pipeline *p = data;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (p->next_work == p->next_fill && !p->finished)
+            pthread_cond_wait(&p->changed, &p->lock);
+        if (p->next_work == p->next_fill)
+            break;
+
+        Slot *slot = &p->slots[p->next_work++ % p->slot_count];
+        pthread_mutex_unlock(&p->lock);
+
+        p->cipher->apply(slot->buf, slot->len, &p->cipher->key, slot->offset);
+
+        pthread_mutex_lock(&p->lock);
+        slot->done = 1;
+        pthread_cond_broadcast(&p->changed);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static void *pipeline_writer(void *data) {
+    Pipeline *p = data;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        Slot *slot = &p->slots[p->next_write % p->slot_count];
+        while (!(p->next_write < p->next_fill && slot->done) &&
+               !(p->finished && p->next_write == p->next_fill))
+            pthread_cond_wait(&p->changed, &p->lock);
+        if (p->next_write == p->next_fill)
+            break;
+        pthread_mutex_unlock(&p->lock);
+
+        // after a failed write the rest is drained without writing
+        int ok = p->failed || write_all(p->out, slot->buf, slot->len) == 0;
+
+        pthread_mutex_lock(&p->lock);
+        if (!ok) {
+            perror("write");
+            p->failed = 1;
+        }
+        slot->done = 0;
+        p->next_write++;
+        pthread_cond_broadcast(&p->changed);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+// stream_blocks with `threads` workers transforming blocks in parallel.
+// The output is byte for byte what one thread would write.
+int stream_parallel(int in, int out, const Cipher *cipher, int threads) {
+    if (threads <= 1)
+        return stream_blocks(in, out, cipher);
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+
+    Pipeline p;
+    memset(&p, 0, sizeof(p));
+    p.cipher = cipher;
+    p.out = out;
+    p.slot_count = (long)threads * SLOTS_PER_THREAD;
+    p.slots = calloc((size_t)p.slot_count, sizeof(Slot));
+    if (!p.slots) {
+        perror("calloc");
+        return -1;
+    }
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.changed, NULL);
+
+    // A failure while setting up marks the pipeline failed: the read loop
+    // below then stops at once and the shutdown path joins whatever
+    // threads did start and frees whatever buffers were allocated.
+    for (long i = 0; i < p.slot_count && !p.failed; i++) {
+        p.slots[i].buf = malloc(BLOCK_SIZE);
+        if (!p.slots[i].buf) {
+            perror("malloc");
+            p.failed = 1;
+        }
+    }
+
+    pthread_t workers[MAX_THREADS], writer;
+    int started = 0, writer_started = 0;
+    while (!p.failed && started < threads) {
+        if (pthread_create(&workers[started], NULL, pipeline_worker, &p) != 0) {
+            fprintf(stderr, "pthread_create failed\n");
+            pthread_mutex_lock(&p.lock);
+            p.failed = 1;
+            pthread_mutex_unlock(&p.lock);
+            break;
+        }
+        started++;
+    }
+    if (!p.failed) {
+        if (pthread_create(&writer, NULL, pipeline_writer, &p) == 0) {
+            writer_started = 1;
+        } else {
+            fprintf(stderr, "pthread_create failed\n");
+            pthread_mutex_lock(&p.lock);
+            p.failed = 1;
+            pthread_mutex_unlock(&p.lock);
+        }
+    }
+
+    uint64_t offset = 0;
+    int read_failed = 0;
+    for (;;) {
+        pthread_mutex_lock(&p.lock);
+        while (p.next_fill - p.next_write == p.slot_count && !p.failed)
+            pthread_cond_wait(&p.changed, &p.lock);
+        Slot *slot = &p.slots[p.next_fill % p.slot_count];
+        int stop = p.failed;
+        pthread_mutex_unlock(&p.lock);
+        if (stop)
+            break;
+
+        // full blocks, so a slow pipe doesn't fill the ring with slivers
+        ssize_t n = read_full(in, slot->buf, BLOCK_SIZE);
+        if (n < 0) {
+            perror("read");
+            read_failed = 1;
+            break;
+        }
+        if (n == 0)
+            break;
+
+        slot->len = (size_t)n;
+        slot->offset = offset;
+        offset += (uint64_t)n;
+
+        pthread_mutex_lock(&p.lock);
+        p.next_fill++;
+        pthread_cond_broadcast(&p.changed);
+        pthread_mutex_unlock(&p.lock);
+
+        if (n < BLOCK_SIZE)
+            break;
+    }
+
+    pthread_mutex_lock(&p.lock);
+    p.finished = 1;
+    pthread_cond_broadcast(&p.changed);
+    pthread_mutex_unlock(&p.lock);
+
+    for (int t = 0; t < started; t++)
+        pthread_join(workers[t], NULL);
+    if (writer_started)
+        pthread_join(writer, NULL);
+
+    for (long i = 0; i < p.slot_count; i++)
+        free(p.slots[i].buf);
+    free(p.slots);
+    pthread_mutex_destroy(&p.lock);
+    pthread_cond_destroy(&p.changed);
+    return (p.failed || read_failed) ? -1 : 0;
+}
+
+// one thread's share of a buffer in slice_pool_apply
+typedef struct {
+    unsigned char *buf;
+    size_t len;
+    uint64_t offset;
+} Slice;
+
+// Workers that split one buffer at a time between them. They are started
+// once per run and woken for each buffer, so a stream of 1 MB blocks
+// doesn't pay a pthread_create and a join per block. Slices are claimed
+// under the lock by whoever gets there first, the calling thread included,
+// so the pool still finishes every buffer if some workers never started.
+typedef struct {
+    const Cipher *cipher;
+    int threads;            // slices per buffer
+    int started;            // workers running besides the caller
+    pthread_t ids[MAX_THREADS];
+    Slice slices[MAX_THREADS];
+    int count;              // slices in the current buffer
+    int next;               // next slice to claim
+    int pending;            // slices claimed or not, not yet done
+    long generation;        // bumped for every buffer
+    int quit;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+} SlicePool;
+
+// Runs slices until none are left to claim; called with the lock held.
+static void run_slices(SlicePool *pool) {
+    while (pool->next < pool->count) {
+        Slice *s = &pool->slices[pool->next++];
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->cipher->apply(s->buf, s->len, &pool->cipher->key, s->offset);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->done);
+    }
+}
+
+static void *slice_worker(void *data) {
+    SlicePool *pool = data;
+    long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen && !pool->quit)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->quit)
+            break;
+        seen = pool->generation;
+        run_slices(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Starts threads - 1 workers; the calling thread is the last one.
+void slice_pool_init(SlicePool *pool, const Cipher *cipher, int threads) {
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->cipher = cipher;
+    pool->threads = threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    while (pool->started < threads - 1 &&
+           pthread_create(&pool->ids[pool->started], NULL, slice_worker, pool) == 0)
+        pool->started++;
+}
+
+void slice_pool_destroy(SlicePool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int t = 0; t < pool->started; t++)
+        pthread_join(pool->ids[t], NULL);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+}
+
+// Transforms one buffer that starts at `offset` in the stream, split into
+// one slice per thread, and returns once every slice is done. Slices start
+// on 256-byte boundaries so ChaCha stays on its 4-block path.
+void slice_pool_apply(SlicePool *pool, unsigned char *buf, size_t len,
+                      uint64_t offset)
+{
+    int threads = pool->started + 1 < pool->threads ? pool->started + 1
+                                                    : pool->threads;
+    size_t per = (len / (size_t)threads + 255) & ~(size_t)255;
+    if (per == 0)
+        per = 256;
+
+    pthread_mutex_lock(&pool->lock);
+    size_t start = 0;
+    int count = 0;
+    while (count < threads && start < len) {
+        size_t n = (count == threads - 1 || len - start < per) ? len - start : per;
+        pool->slices[count] = (Slice){ buf + start, n, offset + start };
+        start += n;
+        count++;
+    }
+
+    pool->count = count;
+    pool->next = 0;
+    pool->pending = count;
+    pool->generation++;
+    if (count > 1)
+        pthread_cond_broadcast(&pool->wake);
+
+    run_slices(pool);
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+#ifndef _WIN32
+// Transforms an open file where it is on disk: the file is mapped
+// MAP_SHARED a window at a time, so the bytes never pass through read()
+// or write() and the page cache writes them back.
+int inplace_fd(int fd, const Cipher *cipher, int threads) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        perror("fstat");
+        return -1;
+    }
+
+    SlicePool pool;
+    slice_pool_init(&pool, cipher, threads);
+
+    int result = 0;
+    off_t size = st.st_size;
+    for (off_t offset = 0; offset < size; offset += MAP_WINDOW) {
+        size_t len = (size - offset < MAP_WINDOW) ? (size_t)(size - offset)
+                                                  : MAP_WINDOW;
+
+        unsigned char *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, fd, offset);
+        if (p == MAP_FAILED) {
+            perror("mmap");
+            result = -1;
+            break;
+        }
+        posix_madvise(p, len, POSIX_MADV_SEQUENTIAL);
+
+        slice_pool_apply(&pool, p, len, (uint64_t)offset);
+        munmap(p, len);
+    }
+
+    slice_pool_destroy(&pool);
+    return result;
+}
+
+int inplace_file(const char *path, const Cipher *cipher, int threads) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+
+    int result = inplace_fd(fd, cipher, threads);
+    close(fd);
+    return result;
+}
+#endif
+
+#ifdef __linux__
+// Linux fast paths for when the output is a pipe (or, untransformed, a
+// file). They return -2 without touching the data when they don't apply.
+
+// Moves bytes that need no transform without bringing them into user
+// space at all: splice() when either side is a pipe, copy_file_range()
+// between two files, sendfile() from a file to anything else.
+int pass_through(int in, int out) {
+    struct stat si, so;
+    if (fstat(in, &si) < 0 || fstat(out, &so) < 0)
+        return -2;
+
+    int pipes = S_ISFIFO(si.st_mode) || S_ISFIFO(so.st_mode);
+    int files = S_ISREG(si.st_mode) && S_ISREG(so.st_mode);
+    if (!pipes && !S_ISREG(si.st_mode))
+        return -2;
+
+    uint64_t moved = 0;
+    for (;;) {
+        ssize_t n;
+        if (pipes)
+            n = splice(in, NULL, out, NULL, PIPE_BYTES, SPLICE_F_MOVE | SPLICE_F_MORE);
+        else if (files)
+            n = copy_file_range(in, NULL, out, NULL, PIPE_BYTES, 0);
+        else
+            n = sendfile(out, in, NULL, PIPE_BYTES);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            // e.g. copy_file_range across filesystems on older kernels,
+            // or into an O_APPEND file (>>), which it refuses with EBADF
+            if (files && (errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+                          errno == EBADF)) {
+                files = 0;
+                continue;
+            }
+            if (moved == 0 && (errno == EINVAL || errno == ENOSYS))
+                return -2;
+            perror("pass-through");
+            return -1;
+        }
+        if (n == 0)
+            return 0;
+        moved += (uint64_t)n;
+    }
+}
+
+// read() into freshly mapped pages, transform, then vmsplice() the pages
+// into the output pipe with SPLICE_F_GIFT instead of write()-ing a copy
+// of them. The pipe holds references to those pages, and a reader that
+// splices them onward (another `--transform none` stage, say) keeps them
+// alive for as long as it likes, so they are never written again: every
+// block gets new pages and ours are unmapped as soon as they are in.
+int stream_vmsplice(int in, int out, const Cipher *cipher, int threads) {
+    struct stat so;
+    if (fstat(out, &so) < 0 || !S_ISFIFO(so.st_mode))
+        return -2;
+
+    long size = fcntl(out, F_SETPIPE_SZ, PIPE_BYTES);
+    if (size < 0)
+        size = fcntl(out, F_GETPIPE_SZ);
+    if (size <= 0)
+        return -2;
+
+    SlicePool pool;
+    slice_pool_init(&pool, cipher, threads);
+
+    int result = 0;
+    uint64_t offset = 0;
+    for (;;) {
+        unsigned char *buf = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buf == MAP_FAILED) {
+            perror("mmap");
+            result = -1;
+            break;
+        }
+
+        ssize_t n = read_full(in, buf, (size_t)size);
+        if (n <= 0) {
+            if (n < 0) {
+                perror("read");
+                result = -1;
+            }
+            munmap(buf, (size_t)size);
+            break;
+        }
+
+        slice_pool_apply(&pool, buf, (size_t)n, offset);
+        offset += (uint64_t)n;
+
+        struct iovec iov = { buf, (size_t)n };
+        while (iov.iov_len > 0) {
+            ssize_t w = vmsplice(out, &iov, 1, SPLICE_F_GIFT);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            iov.iov_base = (unsigned char *)iov.iov_base + w;
+            iov.iov_len -= (size_t)w;
+        }
+
+        // munmap only drops our mapping; the pipe keeps its own references
+        munmap(buf, (size_t)size);
+        if (iov.iov_len > 0) {
+            perror("vmsplice");
+            result = -1;
+            break;
+        }
+
+        if (n < size)
+            break;
+    }
+
+    slice_pool_destroy(&pool);
+    return result;
+}
+
+int stream_zero_copy(int in, int out, const Cipher *cipher, int threads) {
+    if (cipher->apply == none_apply)
+        return pass_through(in, out);
+    return stream_vmsplice(in, out, cipher, threads);
+}
+#endif
+
+static void print_rate(const char *name, size_t bytes, double seconds) {
+    printf("%-28s %9.3f s %9.3f GB/s\n", name, seconds, bytes / seconds / 1e9);
+}
+
+// printable text, like the logs this usually runs over
+static void fill_text(unsigned char *data, size_t size) {
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (unsigned char)(' ' + (seed >> 16) % 95);
+    }
+}
+
+// Throughput of each path over the same file. The file was just written, so
+// it sits in the page cache: this measures the program, not the disk. The
+// output goes to the null device. Best of `repeats`, except the per-char
+// loop, which is slow enough that one run is plenty.
+int run_benchmark(size_t megabytes, int repeats) {
+    size_t size = megabytes << 20;
+    unsigned char *data = malloc(size);
+    if (!data) {
+        perror("malloc");
+        return 1;
+    }
+    fill_text(data, size);
+
+    FILE *tmp = tmpfile();
+    int out = open(NULL_DEVICE, O_WRONLY);
+    FILE *out_file = fopen(NULL_DEVICE, "wb");
+    if (!tmp || out < 0 || !out_file) {
+        perror("benchmark files");
+        return 1;
+    }
+    int fd = fileno(tmp);
+    if (write_all(fd, data, size) < 0) {
+        perror("write");
+        return 1;
     }
- }
\ No newline at end of file
+
+    Cipher not_cipher = { not_apply, { { 0 } } };
+
+#if defined(__AVX2__)
+    const char *isa = "AVX2";
+#elif defined(__SSE2__)
+    const char *isa = "SSE2";
+#else
+    const char *isa = "scalar";
+#endif
+    printf("%zu MB, %s kernel, %d KB blocks, best of %d\n\n",
+           megabytes, isa, BLOCK_SIZE >> 10, repeats);
+
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        double t0 = now_seconds();
+        transform_block(data, size);
+        double t = now_seconds() - t0;
+        if (t < best) best = t;
+    }
+    print_rate("kernel (memory only)", size, best);
+
+    best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        lseek(fd, 0, SEEK_SET);
+        double t0 = now_seconds();
+        stream_blocks(fd, out, &not_cipher);
+        double t = now_seconds() - t0;
+        if (t < best) best = t;
+    }
+    print_rate("read/write blocks", size, best);
+    double blocks = best;
+
+#ifndef _WIN32
+    best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        double t0 = now_seconds();
+        inplace_fd(fd, &not_cipher, 1);
+        double t = now_seconds() - t0;
+        if (t < best) best = t;
+    }
+    print_rate("in place (mmap)", size, best);
+#endif
+
+    rewind(tmp);
+    double t0 = now_seconds();
+    stream_chars(tmp, out_file);
+    fflush(out_file);
+    double chars = now_seconds() - t0;
+    print_rate("getc/putc per char", size, chars);
+
+    printf("\nread/write blocks are %.1fx the per-char loop\n", chars / blocks);
+
+    fclose(out_file);
+    close(out);
+    fclose(tmp);
+    free(data);
+    return 0;
+}
+
+// Hash of everything in fd from the start, to compare two outputs.
+static int hash_file(int fd, unsigned char *block, uint64_t *hash) {
+    uint64_t h = 0;
+    lseek(fd, 0, SEEK_SET);
+    for (;;) {
+        ssize_t n = read_full(fd, block, BLOCK_SIZE);
+        if (n < 0)
+            return -1;
+        for (ssize_t i = 0; i < n; i++)
+            h = (h ^ block[i]) * 0x100000001B3ull;
+        if (n < BLOCK_SIZE)
+            break;
+    }
+    *hash = mix64(h);
+    return 0;
+}
+
+// How each transform scales with threads. Every transform streams the same
+// page-cached file through the pipeline into the null device. Each thread
+// count then runs once more, untimed, into a scratch file, and its output
+// is checked against the single-thread run with a checksum.
+int run_scaling(size_t megabytes, int max_threads) {
+    size_t size = megabytes << 20;
+    unsigned char *block = malloc(BLOCK_SIZE);
+    FILE *tmp = tmpfile();
+    FILE *check = tmpfile();
+    int out = open(NULL_DEVICE, O_WRONLY);
+    if (!block || !tmp || !check || out < 0) {
+        perror("benchmark files");
+        return 1;
+    }
+
+    // written a block at a time, so multi-GB runs don't need the RAM twice
+    int fd = fileno(tmp);
+    fill_text(block, BLOCK_SIZE);
+    for (size_t done = 0; done < size; done += BLOCK_SIZE)
+        if (write_all(fd, block, BLOCK_SIZE) < 0) {
+            perror("write");
+            return 1;
+        }
+
+    if (max_threads > MAX_THREADS)
+        max_threads = MAX_THREADS;
+    printf("%zu MB, up to %d threads, %d KB blocks\n\n",
+           megabytes, max_threads, BLOCK_SIZE >> 10);
+    printf("%-8s %7s %9s %9s %8s\n", "", "threads", "seconds", "GB/s", "speedup");
+
+    for (size_t k = 0; k < sizeof(transforms) / sizeof(transforms[0]); k++) {
+        Cipher cipher;
+        cipher.apply = transforms[k].apply;
+        key_from_passphrase(&cipher.key, "benchmark");
+
+        // the transform alone on one thread, over a block that stays in cache
+        double t0 = now_seconds();
+        for (int r = 0; r < 32; r++)
+            cipher.apply(block, BLOCK_SIZE, &cipher.key, 0);
+        double kernel = (now_seconds() - t0) / 32.0;
+
+        double base = 0.0;
+        uint64_t expected = 0;
+        for (int threads = 1; threads <= max_threads;
+             threads = (threads * 2 > max_threads && threads < max_threads)
+                       ? max_threads : threads * 2) {
+            lseek(fd, 0, SEEK_SET);
+            t0 = now_seconds();
+            int failed = stream_parallel(fd, out, &cipher, threads) < 0;
+            double t = now_seconds() - t0;
+
+            uint64_t hash = 0;
+            int cfd = fileno(check);
+            lseek(fd, 0, SEEK_SET);
+            lseek(cfd, 0, SEEK_SET);
+            // same size every run, so overwriting from the start is enough
+            failed = failed || stream_parallel(fd, cfd, &cipher, threads) < 0 ||
+                     hash_file(cfd, block, &hash) < 0;
+            if (failed) {
+                fprintf(stderr, "%s: streaming failed with %d threads\n",
+                        transforms[k].name, threads);
+                return 1;
+            }
+
+            if (threads == 1) {
+                base = t;
+                expected = hash;
+            } else if (hash != expected) {
+                fprintf(stderr, "%s: output with %d threads differs from 1 thread\n",
+                        transforms[k].name, threads);
+                return 1;
+            }
+
+            printf("%-8s %7d %9.3f %9.3f %7.2fx\n", transforms[k].name, threads,
+                   t, size / t / 1e9, base / t);
+        }
+        printf("%-8s %7s %9s %9.3f (kernel, cached block)\n\n",
+               transforms[k].name, "1", "", BLOCK_SIZE / kernel / 1e9);
+    }
+
+    close(out);
+    fclose(check);
+    fclose(tmp);
+    free(block);
+    return 0;
+}
+
+#ifdef __linux__
+// CPU cycles of this process and the threads it starts from here on, or -1
+// when perf events aren't allowed. Kernel time is included if permitted,
+// since that is where splice does its work.
+static int open_cycle_counter(int *with_kernel) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_hv = 1;
+
+    int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    *with_kernel = fd >= 0;
+    if (fd < 0) {
+        attr.exclude_kernel = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    return fd;
+}
+
+static double cpu_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// producer | main | consumer, with this process as the middle stage. The
+// producer writes `size` bytes from memory, the consumer read()s and drops
+// them. Only the middle stage is measured for CPU: cycles (-1 if perf
+// events aren't allowed) and CPU time. Both pipes are PIPE_BYTES big.
+static int time_pipeline(size_t size, const Cipher *cipher, int zero_copy,
+                         double *seconds, double *cycles, int *with_kernel,
+                         double *cpu)
+{
+    int a[2], b[2];
+    if (pipe(a) < 0 || pipe(b) < 0) {
+        perror("pipe");
+        return -1;
+    }
+    fcntl(a[1], F_SETPIPE_SZ, PIPE_BYTES);
+    fcntl(b[1], F_SETPIPE_SZ, PIPE_BYTES);
+
+    pid_t producer = fork();
+    if (producer == 0) {
+        close(a[0]); close(b[0]); close(b[1]);
+        unsigned char *block = malloc(BLOCK_SIZE);
+        fill_text(block, BLOCK_SIZE);
+        for (size_t done = 0; done < size; done += BLOCK_SIZE)
+            if (write_all(a[1], block, BLOCK_SIZE) < 0)
+                _exit(1);
+        _exit(0);
+    }
+
+    pid_t consumer = fork();
+    if (consumer == 0) {
+        close(a[0]); close(a[1]); close(b[1]);
+        unsigned char *block = malloc(BLOCK_SIZE);
+        while (read(b[0], block, BLOCK_SIZE) > 0)
+            ;
+        _exit(0);
+    }
+    close(a[1]);
+    close(b[0]);
+
+    int counter = open_cycle_counter(with_kernel);
+    double cpu0 = cpu_seconds();
+    double t0 = now_seconds();
+    if (counter >= 0)
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+
+    int result = zero_copy ? stream_zero_copy(a[0], b[1], cipher, 1) : -2;
+    if (result == -2)
+        result = stream_blocks(a[0], b[1], cipher);
+    close(a[0]);
+    close(b[1]);
+    waitpid(producer, NULL, 0);
+    waitpid(consumer, NULL, 0);
+
+    *seconds = now_seconds() - t0;
+    *cpu = cpu_seconds() - cpu0;
+    *cycles = -1.0;
+    if (counter >= 0) {
+        uint64_t count;
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter, &count, sizeof(count)) == sizeof(count))
+            *cycles = (double)count;
+        close(counter);
+    }
+    return result;
+}
+
+int run_pipe_benchmark(size_t megabytes) {
+    size_t size = megabytes << 20;
+    static const char *names[] = { "none", "not", "chacha" };
+
+    printf("producer | main | consumer, %zu MB, %d KB pipes\n\n",
+           megabytes, PIPE_BYTES >> 10);
+    printf("%-8s %-10s %9s %9s %13s %12s\n",
+           "", "path", "seconds", "GB/s", "cycles/byte", "CPU ns/byte");
+
+    int user_only = 0;
+    for (size_t k = 0; k < sizeof(names) / sizeof(names[0]); k++) {
+        Cipher cipher;
+        cipher.apply = find_transform(names[k])->apply;
+        key_from_passphrase(&cipher.key, "benchmark");
+
+        for (int zero_copy = 0; zero_copy < 2; zero_copy++) {
+            double seconds, cycles, cpu;
+            int with_kernel;
+            if (time_pipeline(size, &cipher, zero_copy, &seconds, &cycles,
+                              &with_kernel, &cpu) < 0)
+                return 1;
+
+            const char *path = !zero_copy ? "read/write"
+                             : cipher.apply == none_apply ? "splice" : "vmsplice";
+            char per_byte[32] = "n/a";
+            if (cycles >= 0.0) {
+                user_only |= !with_kernel;
+                snprintf(per_byte, sizeof(per_byte), "%.3f%s",
+                         cycles / size, with_kernel ? "" : "*");
+            }
+            printf("%-8s %-10s %9.3f %9.3f %13s %12.3f\n", names[k], path,
+                   seconds, size / seconds / 1e9, per_byte, cpu * 1e9 / size);
+        }
+    }
+
+    if (user_only)
+        printf("\n* user-space cycles only (perf_event_paranoid hides kernel time)\n");
+    return 0;
+}
+#endif
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: main [--transform none|not|counter|chacha] [--key PASSPHRASE]\n"
+        "            [--threads N] [--no-splice] [--inplace FILE...]\n"
+        "       main --chars\n"
+        "       main --bench [MB [REPEATS]]\n"
+        "       main --scale [MB [MAX_THREADS]]\n"
+        "       main --pipe-bench [MB]\n");
+}
+
+ int main(int argc, char *argv[]){
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    if (argc > 1 && strcmp(argv[1], "--chars") == 0) {
+        stream_chars(stdin, stdout);
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        long mb = (argc > 2) ? atol(argv[2]) : 256;
+        int repeats = (argc > 3) ? atoi(argv[3]) : 3;
+        return run_benchmark(mb > 0 ? (size_t)mb : 256, repeats > 0 ? repeats : 3);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--scale") == 0) {
+        long mb = (argc > 2) ? atol(argv[2]) : 1024;
+        int threads = (argc > 3) ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        return run_scaling(mb > 0 ? (size_t)mb : 1024, threads > 0 ? threads : 1);
+    }
+
+#ifdef __linux__
+    if (argc > 1 && strcmp(argv[1], "--pipe-bench") == 0) {
+        long mb = (argc > 2) ? atol(argv[2]) : 1024;
+        return run_pipe_benchmark(mb > 0 ? (size_t)mb : 1024);
+    }
+#endif
+
+    const char *name = "not";
+    const char *pass = NULL;
+    int threads = 1;
+    int splice_ok = 1;
+    int first_file = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--transform") == 0 && i + 1 < argc)
+            name = argv[++i];
+        else if (strcmp(argv[i], "--key") == 0 && i + 1 < argc)
+            pass = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-splice") == 0)
+            splice_ok = 0;
+        else if (strcmp(argv[i], "--inplace") == 0 && i + 1 < argc) {
+            first_file = i + 1;
+            break;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    const NamedTransform *t = find_transform(name);
+    if (!t) {
+        fprintf(stderr, "unknown transform '%s'\n", name);
+        usage();
+        return 1;
+    }
+    if (t->keyed && !pass) {
+        fprintf(stderr, "transform '%s' needs --key\n", name);
+        return 1;
+    }
+
+    Cipher cipher;
+    memset(&cipher, 0, sizeof(cipher));
+    cipher.apply = t->apply;
+    if (pass)
+        key_from_passphrase(&cipher.key, pass);
+    if (threads < 1)
+        threads = 1;
+
+    if (first_file) {
+#ifndef _WIN32
+        int result = 0;
+        for (int i = first_file; i < argc; i++)
+            if (inplace_file(argv[i], &cipher, threads) < 0)
+                result = 1;
+        return result;
+#else
+        fprintf(stderr, "--inplace needs mmap, which this build lacks\n");
+        return 1;
+#endif
+    }
+
+#ifdef __linux__
+    if (splice_ok) {
+        int result = stream_zero_copy(STDIN_FILENO, STDOUT_FILENO, &cipher, threads);
+        if (result != -2)
+            return result < 0 ? 1 : 0;
+    }
+#else
+    (void)splice_ok;
+#endif
+
+    return stream_parallel(STDIN_FILENO, STDOUT_FILENO, &cipher, threads) < 0 ? 1 : 0;
+ }
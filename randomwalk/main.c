@@ -1,20 +1,815 @@
 #include <SDL2/SDL.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
+#include "../common/frame_stats.h"
 
 #define WIDTH  900
 #define HEIGHT 800
 
+#define RNG_LANES   4   // 32-bit words per block draw, one per SIMD lane
+#define AGENT_BLOCK 64  // agents moved per draw: 4 lanes x 16 two-bit draws
+#define MAX_THREADS 64
+
+// structure of arrays: the update only streams through x and y,
+// the colors are touched only when drawing
+typedef struct {
+    int count;
+    int capacity;   // count rounded up to AGENT_BLOCK
+    Sint32 *x;
+    Sint32 *y;
+    Uint32 *color;  // packed ARGB8888, ready to store in the framebuffer
+} Agents;
+
+// CPU-side copy of the screen the agents are plotted into. It keeps the
+// faded trails between frames and is uploaded to a streaming texture once
+// per frame. The spare column and row let a 2x2 dot at the right or bottom
+// edge be written without a bounds check.
+typedef struct {
+    Uint32 *pixels;
+    int pitch;      // in pixels: WIDTH + 1
+    int rows;       // HEIGHT + 1
+} Framebuffer;
+
+// Counter-based generator: the bits that move block b on step t are a pure
+// function of (key, t, b), so every block has its own stream and no state is
+// shared between threads. Any split of the blocks over any number of threads
+// produces the exact same walk.
+typedef struct {
+    Uint64 key;
+    Uint64 step;    // steps taken so far
+} WalkRng;
+
+// a contiguous range of agent blocks, advanced by a number of steps
+typedef struct {
+    Agents *agents;
+    Uint64 key;
+    Uint64 step;    // index of the first step
+    int steps;
+    int first;      // blocks [first, last)
+    int last;
+    Uint32 *hist;   // this partition's visit counts, or NULL
+} WalkJob;
+
+typedef struct {
+    SDL_Thread *thread;
+    SDL_sem *start;
+    SDL_sem *done;
+    WalkJob job;
+    int quit;
+} WalkWorker;
+
+typedef struct {
+    int threads;
+    WalkWorker workers[MAX_THREADS];
+} WalkPool;
+
+// Visit counts per pixel. Each partition counts into its own 32-bit
+// histogram, so the walk needs no atomics or locks; between exports the
+// partials are folded into the 64-bit totals and cleared.
 typedef struct {
-    int x;
-    int y;
-    Uint8 r, g, b;
-} Agent;
+    Uint64 *total;
+    Uint32 *part[MAX_THREADS];
+    int parts;
+    Uint64 visits;
+} DensityMap;
+
+// the splitmix64 finalizer: a bijection on 64 bits with good avalanche
+Uint64 mix64(Uint64 z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(WalkRng *rng, Uint64 seed) {
+    rng->key = mix64(seed + 0x9E3779B97F4A7C15ull);
+    rng->step = 0;
+}
+
+// 128 random bits for one block on one step. The counter packs the step
+// above the block index (blocks stay below 2^26 since the agent count is an
+// int), and splitmix64 is exactly mix64(key + counter * golden gamma).
+void rng_block(Uint64 key, Uint64 step, int block, Uint32 out[RNG_LANES]) {
+    Uint64 ctr = (step << 27) | ((Uint64)block << 1);
+    Uint64 a = mix64(key + ctr * 0x9E3779B97F4A7C15ull);
+    Uint64 b = mix64(key + (ctr | 1) * 0x9E3779B97F4A7C15ull);
+
+    out[0] = (Uint32)a;
+    out[1] = (Uint32)(a >> 32);
+    out[2] = (Uint32)b;
+    out[3] = (Uint32)(b >> 32);
+}
+
+void agents_free(Agents *agents) {
+    free(agents->x);
+    free(agents->y);
+    free(agents->color);
+    agents->x = agents->y = NULL;
+    agents->color = NULL;
+}
+
+// On failure nothing is left allocated, so there is nothing to free.
+int agents_init(Agents *agents, int agent_count) {
+    int capacity = (agent_count + AGENT_BLOCK - 1) / AGENT_BLOCK * AGENT_BLOCK;
+
+    agents->count = agent_count;
+    agents->capacity = capacity;
+    agents->x = malloc(sizeof(Sint32) * capacity);
+    agents->y = malloc(sizeof(Sint32) * capacity);
+    agents->color = malloc(sizeof(Uint32) * capacity);
+
+    if (!agents->x || !agents->y || !agents->color) {
+        agents_free(agents);
+        return 0;
+    }
+
+    // padding agents walk too, they just never get drawn
+    for (int i = 0; i < capacity; i++) {
+        agents->x[i] = WIDTH / 2;
+        agents->y[i] = HEIGHT / 2;
+
+        float t = (float)i / agent_count;
+        Uint8 r = (Uint8)(255 * t);
+        Uint8 g = (Uint8)(255 * (1.0f - t));
+        Uint8 b = (Uint8)(128 + 127 * sin(t * 6.28f));
+        agents->color[i] = 0xFF000000u | ((Uint32)r << 16) | ((Uint32)g << 8) | b;
+    }
+    return 1;
+}
+
+int framebuffer_init(Framebuffer *fb) {
+    fb->pitch = WIDTH + 1;
+    fb->rows = HEIGHT + 1;
+    fb->pixels = malloc(sizeof(Uint32) * fb->pitch * fb->rows);
+    if (!fb->pixels)
+        return 0;
+
+    for (int i = 0; i < fb->pitch * fb->rows; i++)
+        fb->pixels[i] = 0xFF000000u;
+    return 1;
+}
+
+void framebuffer_free(Framebuffer *fb) {
+    free(fb->pixels);
+    fb->pixels = NULL;
+}
+
+#ifdef __SSE2__
+static __m128i clamp_epi32(__m128i v, __m128i lo, __m128i hi) {
+#ifdef __SSE4_1__
+    return _mm_min_epi32(_mm_max_epi32(v, lo), hi);
+#else
+    __m128i below = _mm_cmplt_epi32(v, lo);
+    v = _mm_or_si128(_mm_and_si128(below, lo), _mm_andnot_si128(below, v));
+    __m128i above = _mm_cmpgt_epi32(v, hi);
+    return _mm_or_si128(_mm_and_si128(above, hi), _mm_andnot_si128(above, v));
+#endif
+}
+#endif
+
+// Moves every agent of the job's blocks 2px in a random direction per step,
+// branch-free: the two bits of a draw pick the axis (high bit) and the sign
+// (low bit), keeping the old mapping 0:+x 1:-x 2:+y 3:-y. Each block draw
+// gives each of the 4 lanes 16 draws, which move agents base + 4*j + lane.
+// Agents never interact, so a block runs all its steps before the next block
+// starts and stays in L1 the whole time.
+void update_blocks(const WalkJob *job) {
+    Agents *agents = job->agents;
+    Uint32 bits[RNG_LANES];
+
+    for (int block = job->first; block < job->last; block++)
+    for (int s = 0; s < job->steps; s++) {
+        int base = block * AGENT_BLOCK;
+        rng_block(job->key, job->step + s, block, bits);
+
+#ifdef __SSE2__
+        __m128i rnd = _mm_loadu_si128((const __m128i *)bits);
+        __m128i one = _mm_set1_epi32(1);
+        __m128i two = _mm_set1_epi32(2);
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi_x = _mm_set1_epi32(WIDTH - 1);
+        __m128i hi_y = _mm_set1_epi32(HEIGHT - 1);
+
+        for (int j = 0; j < AGENT_BLOCK / RNG_LANES; j++) {
+            __m128i *px = (__m128i *)(agents->x + base + j * RNG_LANES);
+            __m128i *py = (__m128i *)(agents->y + base + j * RNG_LANES);
+
+            __m128i sign = _mm_and_si128(rnd, one);
+            __m128i on_y = _mm_sub_epi32(lo, _mm_and_si128(_mm_srli_epi32(rnd, 1), one));
+            __m128i step = _mm_sub_epi32(two, _mm_slli_epi32(sign, 2));
+
+            __m128i x = _mm_add_epi32(_mm_loadu_si128(px), _mm_andnot_si128(on_y, step));
+            __m128i y = _mm_add_epi32(_mm_loadu_si128(py), _mm_and_si128(on_y, step));
+
+            _mm_storeu_si128(px, clamp_epi32(x, lo, hi_x));
+            _mm_storeu_si128(py, clamp_epi32(y, lo, hi_y));
+
+            rnd = _mm_srli_epi32(rnd, 2);
+        }
+#else
+        for (int j = 0; j < AGENT_BLOCK / RNG_LANES; j++) {
+            for (int lane = 0; lane < RNG_LANES; lane++) {
+                int i = base + j * RNG_LANES + lane;
+                Uint32 dir = (bits[lane] >> (2 * j)) & 3;
+
+                Sint32 step = 2 - 4 * (Sint32)(dir & 1);
+                Sint32 on_y = (Sint32)(dir >> 1);
+
+                Sint32 x = agents->x[i] + step * (1 - on_y);
+                Sint32 y = agents->y[i] + step * on_y;
+
+                x = x < 0 ? 0 : x;
+                x = x > WIDTH - 1 ? WIDTH - 1 : x;
+                y = y < 0 ? 0 : y;
+                y = y > HEIGHT - 1 ? HEIGHT - 1 : y;
+
+                agents->x[i] = x;
+                agents->y[i] = y;
+            }
+        }
+#endif
+
+        if (job->hist) {
+            int end = base + AGENT_BLOCK;
+            if (end > agents->count)
+                end = agents->count;
+            for (int i = base; i < end; i++)
+                job->hist[agents->y[i] * WIDTH + agents->x[i]]++;
+        }
+    }
+}
+
+static int walk_worker_main(void *data) {
+    WalkWorker *worker = data;
+
+    for (;;) {
+        SDL_SemWait(worker->start);
+        if (worker->quit)
+            break;
+        update_blocks(&worker->job);
+        SDL_SemPost(worker->done);
+    }
+    return 0;
+}
+
+// the calling thread always runs one partition itself, so a pool of
+// N threads only spawns N - 1 workers
+void walk_pool_init(WalkPool *pool, int threads) {
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    pool->threads = threads;
+    for (int i = 0; i < threads - 1; i++) {
+        WalkWorker *worker = &pool->workers[i];
+        worker->quit = 0;
+        worker->start = SDL_CreateSemaphore(0);
+        worker->done = SDL_CreateSemaphore(0);
+        worker->thread = SDL_CreateThread(walk_worker_main, "walk", worker);
+    }
+}
+
+void walk_pool_destroy(WalkPool *pool) {
+    for (int i = 0; i < pool->threads - 1; i++) {
+        WalkWorker *worker = &pool->workers[i];
+        worker->quit = 1;
+        SDL_SemPost(worker->start);
+        SDL_WaitThread(worker->thread, NULL);
+        SDL_DestroySemaphore(worker->start);
+        SDL_DestroySemaphore(worker->done);
+    }
+    pool->threads = 1;
+}
+
+// Advances all agents by steps steps, counting every visited pixel when
+// density is not NULL. The blocks are split into one contiguous partition
+// per thread; the result does not depend on the split.
+void update_agents(Agents *agents, WalkRng *rng, WalkPool *pool, int steps,
+                   DensityMap *density) {
+    int blocks = agents->capacity / AGENT_BLOCK;
+    int parts = pool->threads < blocks ? pool->threads : blocks;
+
+    WalkJob job;
+    job.agents = agents;
+    job.key = rng->key;
+    job.step = rng->step;
+    job.steps = steps;
+
+    for (int i = 0; i < parts; i++) {
+        job.first = (int)((Sint64)blocks * i / parts);
+        job.last = (int)((Sint64)blocks * (i + 1) / parts);
+        job.hist = density ? density->part[i] : NULL;
+
+        if (i == parts - 1) {
+            update_blocks(&job);
+        } else {
+            pool->workers[i].job = job;
+            SDL_SemPost(pool->workers[i].start);
+        }
+    }
+    for (int i = 0; i < parts - 1; i++)
+        SDL_SemWait(pool->workers[i].done);
+
+    rng->step += steps;
+    if (density)
+        density->visits += (Uint64)agents->count * steps;
+}
+
+// On failure the map holds whatever was allocated; density_free drops it.
+int density_init(DensityMap *density, int parts) {
+    memset(density, 0, sizeof(*density));
+    density->parts = parts;
+    density->total = calloc(WIDTH * HEIGHT, sizeof(Uint64));
+    if (!density->total)
+        return 0;
+
+    for (int i = 0; i < parts; i++) {
+        density->part[i] = calloc(WIDTH * HEIGHT, sizeof(Uint32));
+        if (!density->part[i])
+            return 0;
+    }
+    return 1;
+}
+
+void density_free(DensityMap *density) {
+    free(density->total);
+    for (int i = 0; i < density->parts; i++)
+        free(density->part[i]);
+    memset(density, 0, sizeof(*density));
+}
+
+// folds the per-partition counts into the totals and clears them
+void density_merge(DensityMap *density) {
+    for (int i = 0; i < density->parts; i++) {
+        Uint32 *part = density->part[i];
+        for (int c = 0; c < WIDTH * HEIGHT; c++) {
+            density->total[c] += part[c];
+            part[c] = 0;
+        }
+    }
+}
+
+// Most steps a partition may take before one of its 32-bit cells could
+// overflow: a cell gains at most one count per agent per step.
+int density_max_steps(const DensityMap *density, const Agents *agents) {
+    int blocks = agents->capacity / AGENT_BLOCK;
+    int parts = density->parts < blocks ? density->parts : blocks;
+    Uint64 per_part = (Uint64)(blocks + parts - 1) / parts * AGENT_BLOCK;
+    Uint64 steps = 0xFFFFFFFFull / per_part;
+    return steps > (1 << 20) ? (1 << 20) : (int)(steps ? steps : 1);
+}
+
+// Writes the totals as a 16-bit binary PGM. Counts span many orders of
+// magnitude, so the gray level is log(1 + count) scaled to the busiest cell.
+int density_save_pgm(const DensityMap *density, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return 0;
+
+    Uint64 max = 0;
+    for (int c = 0; c < WIDTH * HEIGHT; c++)
+        if (density->total[c] > max)
+            max = density->total[c];
+    double scale = max ? 65535.0 / log1p((double)max) : 0.0;
+
+    fprintf(file, "P5\n%d %d\n65535\n", WIDTH, HEIGHT);
+
+    Uint8 row[WIDTH * 2];
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            Uint16 v = (Uint16)(log1p((double)density->total[y * WIDTH + x]) * scale + 0.5);
+            row[2 * x] = v >> 8;    // PGM samples are big-endian
+            row[2 * x + 1] = v & 0xFF;
+        }
+        fwrite(row, 1, sizeof(row), file);
+    }
+
+    fclose(file);
+    return 1;
+}
+
+// raw counts for analysis: WIDTH x HEIGHT native-endian Uint64, row-major
+int density_save_raw(const DensityMap *density, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return 0;
+
+    size_t n = fwrite(density->total, sizeof(Uint64), WIDTH * HEIGHT, file);
+    fclose(file);
+    return n == WIDTH * HEIGHT;
+}
+
+// order-dependent hash of every visible agent position, for comparing runs
+Uint64 agents_checksum(const Agents *agents) {
+    Uint64 h = 0;
+    for (int i = 0; i < agents->count; i++)
+        h = mix64(h ^ ((Uint64)(Uint32)agents->x[i] << 32 | (Uint32)agents->y[i]));
+    return h;
+}
+
+// The trail fade, done on the whole buffer at once: every color channel is
+// scaled by 231/256 (about the 25/255 black overlay the renderer used to
+// blend in) and alpha is left alone.
+void fade_framebuffer(Framebuffer *fb) {
+    int n = fb->pitch * fb->rows;
+    int i = 0;
+
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+    __m128i scale = _mm_setr_epi16(231, 231, 231, 256, 231, 231, 231, 256);
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i *p = (__m128i *)(fb->pixels + i);
+        __m128i v = _mm_loadu_si128(p);
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+        lo = _mm_srli_epi16(_mm_mullo_epi16(lo, scale), 8);
+        hi = _mm_srli_epi16(_mm_mullo_epi16(hi, scale), 8);
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < n; i++) {
+        Uint32 c = fb->pixels[i];
+        Uint32 r = ((c >> 16) & 0xFF) * 231 >> 8;
+        Uint32 g = ((c >> 8) & 0xFF) * 231 >> 8;
+        Uint32 b = (c & 0xFF) * 231 >> 8;
+        fb->pixels[i] = (c & 0xFF000000u) | (r << 16) | (g << 8) | b;
+    }
+}
+
+// every agent is a 2x2 dot, stored straight into the buffer
+void plot_agents(Framebuffer *fb, const Agents *agents) {
+    int pitch = fb->pitch;
+
+    for (int i = 0; i < agents->count; i++) {
+        Uint32 *p = fb->pixels + agents->y[i] * pitch + agents->x[i];
+        Uint32 c = agents->color[i];
+        p[0] = c;
+        p[1] = c;
+        p[pitch] = c;
+        p[pitch + 1] = c;
+    }
+}
+
+// one upload and one copy per frame, whatever the agent count
+void present_framebuffer(SDL_Renderer *renderer, SDL_Texture *texture,
+                         const Framebuffer *fb) {
+    SDL_UpdateTexture(texture, NULL, fb->pixels, fb->pitch * sizeof(Uint32));
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+}
+
+// The old draw path, one renderer call pair per agent. Only kept so the
+// benchmark can compare it against the framebuffer path.
+void draw_agents_rects(SDL_Renderer *renderer, const Agents *agents) {
+    //fade effect by drawing a semi-transparent black rectangle
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 25);
+    SDL_Rect fade = { 0, 0, WIDTH, HEIGHT };
+    SDL_RenderFillRect(renderer, &fade);
+
+    for (int i = 0; i < agents->count; i++) {
+        Uint32 c = agents->color[i];
+        SDL_SetRenderDrawColor(renderer,
+            (c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF, 255);
+
+        SDL_Rect r = { agents->x[i], agents->y[i], 2, 2 };
+        SDL_RenderFillRect(renderer, &r);
+    }
+}
+
+// Two tables: single-threaded update-only agent steps per second up to
+// max_agents, then offscreen frame time for the per-agent renderer calls
+// against the framebuffer path.
+int run_benchmark(int max_agents) {
+    double freq = (double)SDL_GetPerformanceFrequency();
+    WalkPool pool;
+    walk_pool_init(&pool, 1);
+
+    printf("%12s %10s %16s\n", "agents", "ms/step", "agent steps/s");
+
+    for (int n = 2000; ; n *= 10) {
+        Agents agents;
+        WalkRng rng;
+
+        if (n > max_agents)
+            n = max_agents;
+
+        if (!agents_init(&agents, n)) {
+            printf("Out of memory for %d agents\n", n);
+            walk_pool_destroy(&pool);
+            return 1;
+        }
+        rng_seed(&rng, 1);
+
+        int steps = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        double elapsed = 0.0;
+
+        while (steps < 3 || elapsed < 0.5) {
+            update_agents(&agents, &rng, &pool, 1, NULL);
+            steps++;
+            elapsed = (SDL_GetPerformanceCounter() - start) / freq;
+        }
+
+        printf("%12d %10.3f %16.0f\n", n, elapsed * 1000.0 / steps,
+               (double)n * steps / elapsed);
+
+        agents_free(&agents);
+
+        if (n == max_agents)
+            break;
+    }
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    SDL_Texture *texture = renderer ? SDL_CreateTexture(renderer,
+        SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+        WIDTH, HEIGHT) : NULL;
+    Framebuffer fb;
+
+    if (!texture || !framebuffer_init(&fb)) {
+        printf("Offscreen renderer failed: %s\n", SDL_GetError());
+        if (texture)
+            SDL_DestroyTexture(texture);
+        if (renderer)
+            SDL_DestroyRenderer(renderer);
+        SDL_FreeSurface(surface);
+        walk_pool_destroy(&pool);
+        return 1;
+    }
+
+    static const int render_counts[] = { 2000, 20000, 200000, 1000000 };
+
+    printf("\n%12s %14s %14s\n", "agents", "rects ms", "framebuf ms");
+
+    for (int c = 0; c < 4; c++) {
+        Agents agents;
+        WalkRng rng;
+        double ms[2];
+        int n = render_counts[c] < max_agents ? render_counts[c] : max_agents;
+
+        if (!agents_init(&agents, n))
+            break;
+        rng_seed(&rng, 1);
+
+        for (int path = 0; path < 2; path++) {
+            int frames = 0;
+            Uint64 start = SDL_GetPerformanceCounter();
+            double elapsed = 0.0;
+
+            while (frames < 3 || elapsed < 0.5) {
+                update_agents(&agents, &rng, &pool, 1, NULL);
+                if (path == 0) {
+                    draw_agents_rects(renderer, &agents);
+                } else {
+                    fade_framebuffer(&fb);
+                    plot_agents(&fb, &agents);
+                    present_framebuffer(renderer, texture, &fb);
+                }
+                SDL_RenderPresent(renderer);
+                frames++;
+                elapsed = (SDL_GetPerformanceCounter() - start) / freq;
+            }
+            ms[path] = elapsed * 1000.0 / frames;
+        }
+
+        printf("%12d %14.3f %14.3f\n", n, ms[0], ms[1]);
+        agents_free(&agents);
+
+        if (n == max_agents)
+            break;
+    }
+
+    walk_pool_destroy(&pool);
+    framebuffer_free(&fb);
+    SDL_DestroyTexture(texture);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    return 0;
+}
+
+// Runs step_count steps without drawing anything and prints the throughput
+// and a checksum of the final positions. The checksum only depends on the
+// seed, the agent count and the step count, never on the thread count.
+// With density_every > 0 the visit counts are also accumulated and written
+// to out_dir every density_every steps (and once at the end), so only the
+// running totals are ever held in memory.
+int run_walk(Uint64 step_count, int agent_count, int threads, Uint64 seed,
+             Uint64 density_every, const char *out_dir, int raw) {
+    Agents agents;
+    WalkRng rng;
+    WalkPool pool;
+    DensityMap density;
+    DensityMap *map = NULL;
+
+    if (!agents_init(&agents, agent_count)) {
+        printf("Out of memory for %d agents\n", agent_count);
+        return 1;
+    }
+    rng_seed(&rng, seed);
+    walk_pool_init(&pool, threads);
+
+    if (density_every > 0) {
+        if (!density_init(&density, pool.threads)) {
+            printf("Out of memory for the density map\n");
+            density_free(&density);
+            walk_pool_destroy(&pool);
+            agents_free(&agents);
+            return 1;
+        }
+        map = &density;
+    }
+
+    // chunks keep the step count an int and bound the time between
+    // merges and exports; they do not change the result
+    int chunk = map ? density_max_steps(map, &agents) : 1 << 20;
+    int snapshot = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    for (Uint64 done = 0; done < step_count; ) {
+        Uint64 left = step_count - done;
+        if (map && density_every - done % density_every < left)
+            left = density_every - done % density_every;
+
+        int steps = left < (Uint64)chunk ? (int)left : chunk;
+        update_agents(&agents, &rng, &pool, steps, map);
+        done += steps;
+
+        if (!map)
+            continue;
+        density_merge(map);
+
+        if (done % density_every == 0 || done == step_count) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/density_%05d.%s",
+                     out_dir, snapshot, raw ? "bin" : "pgm");
+            if (!(raw ? density_save_raw(map, path) : density_save_pgm(map, path)))
+                printf("Could not write %s\n", path);
+            snapshot++;
+        }
+    }
+
+    double elapsed = (SDL_GetPerformanceCounter() - start) /
+                     (double)SDL_GetPerformanceFrequency();
+    double total = (double)agent_count * (double)step_count;
+
+    printf("%d agents x %llu steps on %d threads, seed %llu\n",
+           agent_count, (unsigned long long)step_count, pool.threads,
+           (unsigned long long)seed);
+    printf("%.3f s, %.0f agent steps/s\n", elapsed, total / elapsed);
+    printf("checksum %016llx\n", (unsigned long long)agents_checksum(&agents));
+
+    if (map) {
+        Uint64 max = 0;
+        for (int c = 0; c < WIDTH * HEIGHT; c++)
+            if (map->total[c] > max)
+                max = map->total[c];
+        printf("%d density snapshots in %s, %llu visits, busiest cell %llu\n",
+               snapshot, out_dir, (unsigned long long)map->visits,
+               (unsigned long long)max);
+        density_free(map);
+    }
+
+    walk_pool_destroy(&pool);
+    agents_free(&agents);
+    return 0;
+}
+
+// renders frame_count frames into an offscreen surface as fast as possible
+int run_headless(int frame_count, int agent_count, Uint64 seed,
+                 int show_stages, const char *dump_dir) {
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+        0, WIDTH, HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    SDL_Texture *texture = renderer ? SDL_CreateTexture(renderer,
+        SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+        WIDTH, HEIGHT) : NULL;
+    Framebuffer fb;
+
+    if (!texture || !framebuffer_init(&fb)) {
+        printf("Offscreen renderer failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    Agents agents;
+    WalkRng rng;
+    if (!agents_init(&agents, agent_count)) {
+        printf("Out of memory for %d agents\n", agent_count);
+        return 1;
+    }
+    rng_seed(&rng, seed); // fixed seed so dumped frames are reproducible
+
+    WalkPool pool;
+    walk_pool_init(&pool, SDL_GetCPUCount());
+
+    FrameTimer timer;
+    frame_timer_init(&timer, frame_count);
+
+    for (int f = 0; f < frame_count; f++) {
+        frame_timer_skip(&timer);
+
+        update_agents(&agents, &rng, &pool, 1, NULL);
+        frame_timer_stage(&timer, STAGE_UPDATE);
+
+        fade_framebuffer(&fb);
+        plot_agents(&fb, &agents);
+        frame_timer_stage(&timer, STAGE_RASTER);
+
+        present_framebuffer(renderer, texture, &fb);
+        SDL_RenderPresent(renderer);
+        frame_timer_stage(&timer, STAGE_PRESENT);
+
+        timer.frames++;
+
+        if (dump_dir) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/frame_%05d.ppm", dump_dir, f);
+            if (!save_ppm(surface, path))
+                printf("Could not write %s\n", path);
+        }
+    }
+
+    print_frame_stats(&timer, show_stages);
+
+    frame_timer_free(&timer);
+    walk_pool_destroy(&pool);
+    agents_free(&agents);
+    framebuffer_free(&fb);
+    SDL_DestroyTexture(texture);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    return 0;
+}
 
 int main(int argc, char *argv[]) {
 
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        int max_agents = (argc > 2) ? atoi(argv[2]) : 20000000;
+        return run_benchmark(max_agents >= 2000 ? max_agents : 2000);
+    }
+
+    if (argc > 2 && strcmp(argv[1], "--walk") == 0) {
+        int agent_count = 2000;
+        int threads = SDL_GetCPUCount();
+        Uint64 seed = 1;
+        Uint64 density_every = 0;
+        const char *out_dir = ".";
+        int raw = 0;
+
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--agents") == 0 && i + 1 < argc)
+                agent_count = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+                threads = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+                seed = strtoull(argv[++i], NULL, 10);
+            else if (strcmp(argv[i], "--density") == 0 && i + 1 < argc)
+                density_every = strtoull(argv[++i], NULL, 10);
+            else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+                out_dir = argv[++i];
+            else if (strcmp(argv[i], "--raw") == 0)
+                raw = 1;
+        }
+
+        return run_walk(strtoull(argv[2], NULL, 10),
+                        agent_count > 0 ? agent_count : 2000, threads, seed,
+                        density_every, out_dir, raw);
+    }
+
+    if (argc > 2 && strcmp(argv[1], "--headless") == 0) {
+        int agent_count = 2000;
+        Uint64 seed = 1;
+        int show_stages = 0;
+        const char *dump_dir = NULL;
+
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--stages") == 0)
+                show_stages = 1;
+            else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+                dump_dir = argv[++i];
+            else if (strcmp(argv[i], "--agents") == 0 && i + 1 < argc)
+                agent_count = atoi(argv[++i]);
+            else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+                seed = strtoull(argv[++i], NULL, 10);
+        }
+
+        int frames = atoi(argv[2]);
+        return run_headless(frames > 0 ? frames : 1,
+                            agent_count > 0 ? agent_count : 2000, seed,
+                            show_stages, dump_dir);
+    }
+
     SDL_Init(SDL_INIT_VIDEO);
 
     SDL_Window *window = SDL_CreateWindow(
@@ -29,28 +824,36 @@ int main(int argc, char *argv[]) {
     SDL_Renderer *renderer =
         SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
 
-    int agent_count = (argc > 1) ? atoi(argv[1]) : 2000;
-    Agent *agents = malloc(sizeof(Agent) * agent_count);
+    SDL_Texture *texture = SDL_CreateTexture(renderer,
+        SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+        WIDTH, HEIGHT);
+    Framebuffer fb;
 
-    srand((unsigned int)time(NULL));
+    if (!texture || !framebuffer_init(&fb)) {
+        printf("Framebuffer setup failed: %s\n", SDL_GetError());
+        return 1;
+    }
 
-    for (int i = 0; i < agent_count; i++) {
-        agents[i].x = WIDTH / 2;
-        agents[i].y = HEIGHT / 2;
+    int agent_count = (argc > 1) ? atoi(argv[1]) : 2000;
+    Agents agents;
+    WalkRng rng;
 
-        float t = (float)i / agent_count;
-        agents[i].r = (Uint8)(255 * t);
-        agents[i].g = (Uint8)(255 * (1.0f - t));
-        agents[i].b = (Uint8)(128 + 127 * sin(t * 6.28f));
+    if (agent_count <= 0 || !agents_init(&agents, agent_count)) {
+        printf("Could not allocate %d agents\n", agent_count);
+        return 1;
     }
 
+    // print the seed so an interesting run can be replayed headless
+    Uint64 seed = (Uint64)time(NULL);
+    rng_seed(&rng, seed);
+    printf("seed %llu\n", (unsigned long long)seed);
+
+    WalkPool pool;
+    walk_pool_init(&pool, SDL_GetCPUCount());
+
     int running = 1;
     SDL_Event e;
 
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-    SDL_RenderPresent(renderer);
-
     while (running) {
 
         while (SDL_PollEvent(&e)) {
@@ -58,38 +861,19 @@ int main(int argc, char *argv[]) {
                 running = 0;
         }
 
-        //fade effect by drawing a semi-transparent black rectangle
-        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 25);
-        SDL_Rect fade = { 0, 0, WIDTH, HEIGHT };
-        SDL_RenderFillRect(renderer, &fade);
-
-        //update and draw agents
-        for (int i = 0; i < agent_count; i++) {
-            int dir = rand() % 4;
-
-            if (dir == 0) agents[i].x += 2;
-            if (dir == 1) agents[i].x -= 2;
-            if (dir == 2) agents[i].y += 2;
-            if (dir == 3) agents[i].y -= 2;
-
-            if (agents[i].x < 0) agents[i].x = 0;
-            if (agents[i].x >= WIDTH) agents[i].x = WIDTH - 1;
-            if (agents[i].y < 0) agents[i].y = 0;
-            if (agents[i].y >= HEIGHT) agents[i].y = HEIGHT - 1;
-
-            SDL_SetRenderDrawColor(renderer,
-                agents[i].r, agents[i].g, agents[i].b, 255);
-
-            SDL_Rect r = { agents[i].x, agents[i].y, 2, 2 };
-            SDL_RenderFillRect(renderer, &r);
-        }
+        update_agents(&agents, &rng, &pool, 1, NULL);
+        fade_framebuffer(&fb);
+        plot_agents(&fb, &agents);
 
+        present_framebuffer(renderer, texture, &fb);
         SDL_RenderPresent(renderer);
         SDL_Delay(16);
     }
 
-    free(agents);
+    walk_pool_destroy(&pool);
+    agents_free(&agents);
+    framebuffer_free(&fb);
+    SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
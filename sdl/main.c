@@ -1,37 +1,132 @@
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-int main(void)
-{
-    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        printf("SDL_Init failed: %s\n", SDL_GetError());
-        return 1;
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#define FRAME_MS    100     // ~10 FPS
+#define SCREEN_ROWS 3
+#define SCREEN_COLS 16
+
+// What one run cost, for comparing the two loops.
+typedef struct {
+    Uint32 start;
+    Uint64 wakeups;     // times the loop woke up: each SDL_Delay / wait return
+    Uint64 frames;
+    Uint64 bytes;       // written to the terminal
+    long switches;      // context switches at the start (getrusage)
+} Stats;
+
+// The cells the terminal is showing, so a frame only has to send the ones
+// that change.
+typedef struct {
+    char cells[SCREEN_ROWS][SCREEN_COLS];
+    int cleared;
+} Screen;
+
+static long context_switches(void) {
+#ifndef _WIN32
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_nvcsw + ru.ru_nivcsw;
+#else
+    return 0;
+#endif
+}
+
+static void stats_init(Stats *s) {
+    memset(s, 0, sizeof(*s));
+    s->start = SDL_GetTicks();
+    s->switches = context_switches();
+}
+
+static void stats_print(const Stats *s, const char *mode) {
+    double seconds = (SDL_GetTicks() - s->start) / 1000.0;
+    if (seconds <= 0.0)
+        seconds = 0.001;
+
+    fprintf(stderr, "%s: %.1f s, %llu frames, %.1f wakeups/s, "
+            "%.1f context switches/s, %.1f bytes/s\n",
+            mode, seconds, (unsigned long long)s->frames,
+            s->wakeups / seconds,
+            (context_switches() - s->switches) / seconds,
+            s->bytes / seconds);
+}
+
+// the frame as rows of cells, padded with spaces
+static void compose(char cells[SCREEN_ROWS][SCREEN_COLS], const char *frame) {
+    const char *rows[SCREEN_ROWS] = { "ASCII Spinner:", "", frame };
+
+    for (int r = 0; r < SCREEN_ROWS; r++) {
+        size_t len = strlen(rows[r]);
+        if (len > SCREEN_COLS) len = SCREEN_COLS;
+        memset(cells[r], ' ', SCREEN_COLS);
+        memcpy(cells[r], rows[r], len);
     }
+}
 
-    SDL_Window *window = SDL_CreateWindow(
-        "ASCII Spinner",
-        SDL_WINDOWPOS_CENTERED,
-        SDL_WINDOWPOS_CENTERED,
-        800,
-        600,
-        SDL_WINDOW_SHOWN
-    );
+// Sends only the cells that differ from what is on screen. Each run of
+// changed cells costs one cursor move ("\033[row;colH", up to 8 bytes), so
+// runs separated by a shorter unchanged gap are sent as one. The first
+// call clears the terminal once; after that the blank screen is the
+// reference. Returns the bytes written.
+static size_t screen_draw(Screen *s, const char *frame) {
+    char next[SCREEN_ROWS][SCREEN_COLS];
+    char out[512];
+    size_t len = 0;
 
-    if (!window) {
-        printf("Window creation failed: %s\n", SDL_GetError());
-        SDL_Quit();
-        return 1;
+    compose(next, frame);
+
+    if (!s->cleared) {
+        len += sprintf(out + len, "\033[2J");
+        memset(s->cells, ' ', sizeof(s->cells));
+        s->cleared = 1;
     }
 
-    const char *frames[] = {
-        "    O    ",
-        "   \\ O / ",
-        "     |   ",
-        "   / O \\ ",
-    };
+    for (int r = 0; r < SCREEN_ROWS; r++) {
+        int c = 0;
+        while (c < SCREEN_COLS) {
+            if (next[r][c] == s->cells[r][c]) {
+                c++;
+                continue;
+            }
+
+            int end = c + 1, last = c;
+            while (end < SCREEN_COLS && end - last <= 8) {
+                if (next[r][end] != s->cells[r][end])
+                    last = end;
+                end++;
+            }
+
+            len += sprintf(out + len, "\033[%d;%dH", r + 1, c + 1);
+            memcpy(out + len, &next[r][c], (size_t)(last - c + 1));
+            len += (size_t)(last - c + 1);
+            c = last + 1;
+        }
+    }
+
+    if (len == 0)
+        return 0;
+
+    // park the cursor under the spinner
+    len += sprintf(out + len, "\033[%d;1H", SCREEN_ROWS + 1);
+    memcpy(s->cells, next, sizeof(next));
+
+    fwrite(out, 1, len, stdout);
+    fflush(stdout);
+    return len;
+}
+
+// The original loop: wake every millisecond, check the clock, clear and
+// reprint the whole terminal on every frame.
+static void run_polling(const char **frames, int frame_count, Uint32 seconds) {
+    Stats stats;
+    stats_init(&stats);
 
-    int frame_count = sizeof(frames) / sizeof(frames[0]);
     int frame = 0;
     int running = 1;
 
@@ -47,21 +142,130 @@ int main(void)
         }
 
         Uint32 now = SDL_GetTicks();
-        if (now - last > 100) { // ~10 FPS
+        if (now - last > FRAME_MS) {
             last = now;
 
             // Clear terminal (ANSI escape)
-            printf("\033[2J\033[H");
-            printf("ASCII Spinner:\n\n");
-            printf("%s\n", frames[frame]);
+            stats.bytes += printf("\033[2J\033[H");
+            stats.bytes += printf("ASCII Spinner:\n\n");
+            stats.bytes += printf("%s\n", frames[frame]);
 
             frame = (frame + 1) % frame_count;
             fflush(stdout);
+            stats.frames++;
         }
 
+        if (seconds && now - stats.start >= seconds * 1000)
+            running = 0;
+
         SDL_Delay(1); // don’t burn CPU
+        stats.wakeups++;
     }
 
+    stats_print(&stats, "poll");
+}
+
+// Sleeps in SDL_WaitEventTimeout until either an event arrives or the next
+// frame is due, so an idle spinner wakes ~10 times a second instead of
+// 1000. Frames are due on a fixed schedule (every FRAME_MS from the start)
+// rather than FRAME_MS after the last one, so wakeup jitter doesn't add up.
+// Needs SDL 2.0.16 or newer; older versions emulate the timeout by polling.
+static void run_waiting(const char **frames, int frame_count, Uint32 seconds) {
+    Stats stats;
+    stats_init(&stats);
+
+    Screen screen;
+    memset(&screen, 0, sizeof(screen));
+
+    int frame = 0;
+    int running = 1;
+
+    SDL_Event event;
+    Uint32 next = SDL_GetTicks();
+    Uint32 end = stats.start + seconds * 1000;
+
+    while (running) {
+        Uint32 now = SDL_GetTicks();
+
+        if ((Sint32)(now - next) >= 0) {
+            stats.bytes += screen_draw(&screen, frames[frame]);
+            frame = (frame + 1) % frame_count;
+            stats.frames++;
+
+            // after a long stall (e.g. a suspended laptop) skip the missed
+            // frames rather than drawing them all at once
+            next += FRAME_MS;
+            if ((Sint32)(now - next) >= 0)
+                next = now + FRAME_MS;
+        }
+
+        if (seconds && (Sint32)(now - end) >= 0)
+            break;
+
+        Uint32 deadline = next;
+        if (seconds && (Sint32)(end - deadline) < 0)
+            deadline = end;
+        int timeout = (Sint32)(deadline - now) > 0 ? (int)(deadline - now) : 0;
+
+        int got = SDL_WaitEventTimeout(&event, timeout);
+        stats.wakeups++;
+
+        while (got) {
+            if (event.type == SDL_QUIT)
+                running = 0;
+            got = SDL_PollEvent(&event);
+        }
+    }
+
+    stats_print(&stats, "wait");
+}
+
+int main(int argc, char *argv[])
+{
+    int poll = 0;
+    Uint32 seconds = 0;     // 0 = until the window is closed
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--poll") == 0)
+            poll = 1;
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            seconds = (Uint32)atoi(argv[++i]);
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL_Init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    SDL_Window *window = SDL_CreateWindow(
+        "ASCII Spinner",
+        SDL_WINDOWPOS_CENTERED,
+        SDL_WINDOWPOS_CENTERED,
+        800,
+        600,
+        SDL_WINDOW_SHOWN
+    );
+
+    if (!window) {
+        printf("Window creation failed: %s\n", SDL_GetError());
+        SDL_Quit();
+        return 1;
+    }
+
+    const char *frames[] = {
+        "    O    ",
+        "   \\ O / ",
+        "     |   ",
+        "   / O \\ ",
+    };
+
+    int frame_count = sizeof(frames) / sizeof(frames[0]);
+
+    if (poll)
+        run_polling(frames, frame_count, seconds);
+    else
+        run_waiting(frames, frame_count, seconds);
+
     SDL_DestroyWindow(window);
     SDL_Quit();
     return 0;